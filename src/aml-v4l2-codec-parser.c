@@ -0,0 +1,662 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/base/gstbitreader.h>
+#include <gst/base/gstbytereader.h>
+
+#include "aml-v4l2-codec-parser.h"
+
+GST_DEBUG_CATEGORY_EXTERN(aml_v4l2_debug);
+#define GST_CAT_DEFAULT aml_v4l2_debug
+
+/* This is not a full bitstream parser. It only walks the sequence level
+ * headers far enough to predict what the driver will report on the first
+ * V4L2_EVENT_SOURCE_CHANGE. Any syntax we can't handle simply fails the
+ * prediction and the caller falls back to waiting for the event. */
+
+#define H264_NAL_SPS 7
+#define HEVC_NAL_SPS 33
+#define AV1_OBU_SEQUENCE_HEADER 1
+
+#define READ_BITS(br, val, nbits)                               \
+    do                                                          \
+    {                                                           \
+        if (!gst_bit_reader_get_bits_uint32(br, &(val), nbits)) \
+            goto error;                                         \
+    } while (0)
+#define SKIP_BITS(br, nbits)                 \
+    do                                       \
+    {                                        \
+        if (!gst_bit_reader_skip(br, nbits)) \
+            goto error;                      \
+    } while (0)
+#define READ_UE(br, val)                   \
+    do                                     \
+    {                                      \
+        if (!aml_v4l2_read_ue(br, &(val))) \
+            goto error;                    \
+    } while (0)
+#define READ_SE(br, val)                   \
+    do                                     \
+    {                                      \
+        if (!aml_v4l2_read_se(br, &(val))) \
+            goto error;                    \
+    } while (0)
+
+static gboolean
+aml_v4l2_read_ue(GstBitReader *br, guint32 *val)
+{
+    guint leading = 0;
+    guint8 bit = 0;
+    guint32 value = 0;
+
+    while (TRUE)
+    {
+        if (!gst_bit_reader_get_bits_uint8(br, &bit, 1))
+            return FALSE;
+        if (bit)
+            break;
+        if (++leading > 31)
+            return FALSE;
+    }
+
+    if (leading && !gst_bit_reader_get_bits_uint32(br, &value, leading))
+        return FALSE;
+
+    *val = (1U << leading) - 1 + value;
+    return TRUE;
+}
+
+static gboolean
+aml_v4l2_read_se(GstBitReader *br, gint32 *val)
+{
+    guint32 value;
+
+    if (!aml_v4l2_read_ue(br, &value))
+        return FALSE;
+
+    if (value & 1)
+        *val = (value + 1) / 2;
+    else
+        *val = -(gint32)(value / 2);
+    return TRUE;
+}
+
+/* Strip emulation prevention bytes, the returned payload must be freed */
+static guint8 *
+aml_v4l2_nal_unescape(const guint8 *data, gsize size, gsize *out_size)
+{
+    guint8 *out = g_malloc(size);
+    gsize i, n = 0;
+    guint zeros = 0;
+
+    for (i = 0; i < size; i++)
+    {
+        if (zeros >= 2 && data[i] == 0x03)
+        {
+            zeros = 0;
+            continue;
+        }
+        zeros = (data[i] == 0x00) ? zeros + 1 : 0;
+        out[n++] = data[i];
+    }
+
+    *out_size = n;
+    return out;
+}
+
+static gboolean
+aml_v4l2_h264_skip_scaling_list(GstBitReader *br, guint size)
+{
+    gint32 last = 8, next = 8, delta;
+    guint j;
+
+    for (j = 0; j < size; j++)
+    {
+        if (next != 0)
+        {
+            if (!aml_v4l2_read_se(br, &delta))
+                return FALSE;
+            next = (last + delta + 256) % 256;
+        }
+        last = (next == 0) ? last : next;
+    }
+    return TRUE;
+}
+
+static gboolean
+aml_v4l2_h264_parse_sps(const guint8 *nal, gsize size, GstAmlV4l2CodecHeaderInfo *info)
+{
+    GstBitReader br;
+    guint8 *rbsp;
+    gsize rbsp_size;
+    guint32 profile_idc, val, chroma_format_idc = 1;
+    guint32 poc_type, width_mbs, height_map_units, frame_mbs_only;
+    guint32 crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+    guint crop_unit_x, crop_unit_y, i;
+    gint32 sval;
+    gboolean ret = FALSE;
+
+    /* skip the one byte NAL header */
+    rbsp = aml_v4l2_nal_unescape(nal + 1, size - 1, &rbsp_size);
+    gst_bit_reader_init(&br, rbsp, rbsp_size);
+
+    READ_BITS(&br, profile_idc, 8);
+    SKIP_BITS(&br, 16); /* constraint flags, level_idc */
+    READ_UE(&br, val); /* seq_parameter_set_id */
+
+    if (profile_idc == 100 || profile_idc == 110 || profile_idc == 122 ||
+        profile_idc == 244 || profile_idc == 44 || profile_idc == 83 ||
+        profile_idc == 86 || profile_idc == 118 || profile_idc == 128 ||
+        profile_idc == 138 || profile_idc == 139 || profile_idc == 134 ||
+        profile_idc == 135)
+    {
+        READ_UE(&br, chroma_format_idc);
+        if (chroma_format_idc == 3)
+            SKIP_BITS(&br, 1); /* separate_colour_plane_flag */
+        READ_UE(&br, val); /* bit_depth_luma_minus8 */
+        READ_UE(&br, val); /* bit_depth_chroma_minus8 */
+        SKIP_BITS(&br, 1); /* qpprime_y_zero_transform_bypass_flag */
+        READ_BITS(&br, val, 1);
+        if (val) /* seq_scaling_matrix_present_flag */
+        {
+            for (i = 0; i < ((chroma_format_idc != 3) ? 8 : 12); i++)
+            {
+                READ_BITS(&br, val, 1);
+                if (val && !aml_v4l2_h264_skip_scaling_list(&br, (i < 6) ? 16 : 64))
+                    goto error;
+            }
+        }
+    }
+
+    READ_UE(&br, val); /* log2_max_frame_num_minus4 */
+    READ_UE(&br, poc_type);
+    if (poc_type == 0)
+    {
+        READ_UE(&br, val); /* log2_max_pic_order_cnt_lsb_minus4 */
+    }
+    else if (poc_type == 1)
+    {
+        guint32 cycle;
+
+        SKIP_BITS(&br, 1); /* delta_pic_order_always_zero_flag */
+        READ_SE(&br, sval);
+        READ_SE(&br, sval);
+        READ_UE(&br, cycle);
+        for (i = 0; i < cycle; i++)
+            READ_SE(&br, sval);
+    }
+
+    READ_UE(&br, val); /* max_num_ref_frames */
+    SKIP_BITS(&br, 1); /* gaps_in_frame_num_value_allowed_flag */
+    READ_UE(&br, width_mbs);
+    READ_UE(&br, height_map_units);
+    READ_BITS(&br, frame_mbs_only, 1);
+    if (!frame_mbs_only)
+        SKIP_BITS(&br, 1); /* mb_adaptive_frame_field_flag */
+    SKIP_BITS(&br, 1); /* direct_8x8_inference_flag */
+    READ_BITS(&br, val, 1);
+    if (val) /* frame_cropping_flag */
+    {
+        READ_UE(&br, crop_left);
+        READ_UE(&br, crop_right);
+        READ_UE(&br, crop_top);
+        READ_UE(&br, crop_bottom);
+    }
+
+    width_mbs += 1;
+    height_map_units += 1;
+
+    crop_unit_x = (chroma_format_idc == 1 || chroma_format_idc == 2) ? 2 : 1;
+    crop_unit_y = ((chroma_format_idc == 1) ? 2 : 1) * (2 - frame_mbs_only);
+
+    info->width = width_mbs * 16 - crop_unit_x * (crop_left + crop_right);
+    info->height = height_map_units * 16 * (2 - frame_mbs_only) -
+                   crop_unit_y * (crop_top + crop_bottom);
+    ret = (info->width > 0 && info->height > 0);
+
+error:
+    g_free(rbsp);
+    return ret;
+}
+
+static gboolean
+aml_v4l2_hevc_parse_sps(const guint8 *nal, gsize size, GstAmlV4l2CodecHeaderInfo *info)
+{
+    GstBitReader br;
+    guint8 *rbsp;
+    gsize rbsp_size;
+    guint32 max_sub_layers_minus1, chroma_format_idc, separate_colour_plane = 0;
+    guint32 width, height, val;
+    guint32 conf_left = 0, conf_right = 0, conf_top = 0, conf_bottom = 0;
+    guint32 sub_profile_present[8] = {0}, sub_level_present[8] = {0};
+    guint sub_width_c, sub_height_c, i;
+    gboolean ret = FALSE;
+
+    if (size < 3)
+        return FALSE;
+
+    /* skip the two bytes NAL header */
+    rbsp = aml_v4l2_nal_unescape(nal + 2, size - 2, &rbsp_size);
+    gst_bit_reader_init(&br, rbsp, rbsp_size);
+
+    SKIP_BITS(&br, 4); /* sps_video_parameter_set_id */
+    READ_BITS(&br, max_sub_layers_minus1, 3);
+    SKIP_BITS(&br, 1); /* sps_temporal_id_nesting_flag */
+
+    /* profile_tier_level() */
+    SKIP_BITS(&br, 96);
+    for (i = 0; i < max_sub_layers_minus1; i++)
+    {
+        READ_BITS(&br, sub_profile_present[i], 1);
+        READ_BITS(&br, sub_level_present[i], 1);
+    }
+    if (max_sub_layers_minus1 > 0)
+    {
+        for (i = max_sub_layers_minus1; i < 8; i++)
+            SKIP_BITS(&br, 2);
+    }
+    for (i = 0; i < max_sub_layers_minus1; i++)
+    {
+        if (sub_profile_present[i])
+            SKIP_BITS(&br, 88);
+        if (sub_level_present[i])
+            SKIP_BITS(&br, 8);
+    }
+
+    READ_UE(&br, val); /* sps_seq_parameter_set_id */
+    READ_UE(&br, chroma_format_idc);
+    if (chroma_format_idc == 3)
+        READ_BITS(&br, separate_colour_plane, 1);
+    READ_UE(&br, width);
+    READ_UE(&br, height);
+    READ_BITS(&br, val, 1);
+    if (val) /* conformance_window_flag */
+    {
+        READ_UE(&br, conf_left);
+        READ_UE(&br, conf_right);
+        READ_UE(&br, conf_top);
+        READ_UE(&br, conf_bottom);
+    }
+
+    if (separate_colour_plane)
+        chroma_format_idc = 0;
+    sub_width_c = (chroma_format_idc == 1 || chroma_format_idc == 2) ? 2 : 1;
+    sub_height_c = (chroma_format_idc == 1) ? 2 : 1;
+
+    info->width = width - sub_width_c * (conf_left + conf_right);
+    info->height = height - sub_height_c * (conf_top + conf_bottom);
+    ret = (info->width > 0 && info->height > 0);
+
+error:
+    g_free(rbsp);
+    return ret;
+}
+
+typedef gboolean (*AmlV4l2NalParseFunc)(const guint8 *nal, gsize size,
+                                        GstAmlV4l2CodecHeaderInfo *info);
+
+/* Scan an Annex B byte stream for the first SPS */
+static gboolean
+aml_v4l2_parse_annexb(const guint8 *data, gsize size, gboolean is_hevc,
+                      AmlV4l2NalParseFunc parse, GstAmlV4l2CodecHeaderInfo *info)
+{
+    gsize i = 0, start, end;
+    guint nal_type;
+
+    while (i + 3 <= size)
+    {
+        if (data[i] != 0x00 || data[i + 1] != 0x00 || data[i + 2] != 0x01)
+        {
+            i++;
+            continue;
+        }
+
+        start = i + 3;
+        for (end = start; end + 3 <= size; end++)
+        {
+            if (data[end] == 0x00 && data[end + 1] == 0x00 &&
+                (data[end + 2] == 0x01 || (data[end + 2] == 0x00 && end + 3 < size && data[end + 3] == 0x01)))
+                break;
+        }
+        if (end + 3 > size)
+            end = size;
+
+        if (start < end)
+        {
+            nal_type = is_hevc ? ((data[start] >> 1) & 0x3f) : (data[start] & 0x1f);
+            if (nal_type == (is_hevc ? HEVC_NAL_SPS : H264_NAL_SPS))
+                return parse(data + start, end - start, info);
+        }
+        i = end;
+    }
+
+    return FALSE;
+}
+
+static gboolean
+aml_v4l2_parse_avcc(const guint8 *data, gsize size, GstAmlV4l2CodecHeaderInfo *info)
+{
+    guint16 nal_size;
+
+    /* configurationVersion + 4 bytes profile/level/length + numOfSPS */
+    if (size < 8 || data[0] != 1 || (data[5] & 0x1f) == 0)
+        return FALSE;
+
+    nal_size = GST_READ_UINT16_BE(data + 6);
+    if (nal_size == 0 || 8 + nal_size > size)
+        return FALSE;
+
+    return aml_v4l2_h264_parse_sps(data + 8, nal_size, info);
+}
+
+static gboolean
+aml_v4l2_parse_hvcc(const guint8 *data, gsize size, GstAmlV4l2CodecHeaderInfo *info)
+{
+    GstByteReader br;
+    guint8 num_arrays, type, i;
+    guint16 num_nalus, nal_size, j;
+    const guint8 *nal;
+
+    if (size < 23)
+        return FALSE;
+
+    gst_byte_reader_init(&br, data, size);
+    gst_byte_reader_skip(&br, 22);
+    if (!gst_byte_reader_get_uint8(&br, &num_arrays))
+        return FALSE;
+
+    for (i = 0; i < num_arrays; i++)
+    {
+        if (!gst_byte_reader_get_uint8(&br, &type) ||
+            !gst_byte_reader_get_uint16_be(&br, &num_nalus))
+            return FALSE;
+
+        for (j = 0; j < num_nalus; j++)
+        {
+            if (!gst_byte_reader_get_uint16_be(&br, &nal_size) ||
+                !gst_byte_reader_get_data(&br, nal_size, &nal))
+                return FALSE;
+
+            if ((type & 0x3f) == HEVC_NAL_SPS)
+                return aml_v4l2_hevc_parse_sps(nal, nal_size, info);
+        }
+    }
+
+    return FALSE;
+}
+
+static gboolean
+aml_v4l2_parse_vp9(const guint8 *data, gsize size, GstAmlV4l2CodecHeaderInfo *info)
+{
+    GstBitReader br;
+    guint32 val, profile, width, height;
+
+    gst_bit_reader_init(&br, data, size);
+
+    READ_BITS(&br, val, 2);
+    if (val != 2) /* frame_marker */
+        goto error;
+    READ_BITS(&br, val, 1);
+    READ_BITS(&br, profile, 1);
+    profile = (profile << 1) | val;
+    if (profile == 3)
+        SKIP_BITS(&br, 1);
+    READ_BITS(&br, val, 1);
+    if (val) /* show_existing_frame */
+        goto error;
+    READ_BITS(&br, val, 1);
+    if (val != 0) /* frame_type must be KEY_FRAME */
+        goto error;
+    SKIP_BITS(&br, 2); /* show_frame, error_resilient_mode */
+    READ_BITS(&br, val, 24);
+    if (val != 0x498342) /* frame_sync_code */
+        goto error;
+
+    /* color_config() */
+    if (profile >= 2)
+        SKIP_BITS(&br, 1); /* ten_or_twelve_bit */
+    READ_BITS(&br, val, 3);
+    if (val != 7) /* color_space != CS_RGB */
+    {
+        SKIP_BITS(&br, 1);
+        if (profile == 1 || profile == 3)
+            SKIP_BITS(&br, 3);
+    }
+    else if (profile == 1 || profile == 3)
+    {
+        SKIP_BITS(&br, 1);
+    }
+
+    READ_BITS(&br, width, 16);
+    READ_BITS(&br, height, 16);
+
+    info->width = width + 1;
+    info->height = height + 1;
+    return TRUE;
+
+error:
+    return FALSE;
+}
+
+static gboolean
+aml_v4l2_read_leb128(GstByteReader *br, guint64 *val)
+{
+    guint8 byte;
+    guint i;
+
+    *val = 0;
+    for (i = 0; i < 8; i++)
+    {
+        if (!gst_byte_reader_get_uint8(br, &byte))
+            return FALSE;
+        *val |= ((guint64)(byte & 0x7f)) << (i * 7);
+        if (!(byte & 0x80))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static gboolean
+aml_v4l2_av1_skip_uvlc(GstBitReader *br)
+{
+    guint leading = 0;
+    guint8 bit = 0;
+
+    while (TRUE)
+    {
+        if (!gst_bit_reader_get_bits_uint8(br, &bit, 1))
+            return FALSE;
+        if (bit)
+            break;
+        leading++;
+    }
+    if (leading >= 32)
+        return TRUE;
+    return gst_bit_reader_skip(br, leading);
+}
+
+static gboolean
+aml_v4l2_av1_parse_sequence_header(const guint8 *data, gsize size, GstAmlV4l2CodecHeaderInfo *info)
+{
+    GstBitReader br;
+    guint32 reduced, val, i;
+    guint32 timing_info_present = 0, decoder_model_info_present = 0;
+    guint32 initial_display_delay_present = 0, buffer_delay_length = 0;
+    guint32 operating_points_cnt_minus1, width_bits, height_bits, width, height;
+
+    gst_bit_reader_init(&br, data, size);
+
+    SKIP_BITS(&br, 3); /* seq_profile */
+    SKIP_BITS(&br, 1); /* still_picture */
+    READ_BITS(&br, reduced, 1);
+    if (reduced)
+    {
+        SKIP_BITS(&br, 5); /* seq_level_idx[0] */
+    }
+    else
+    {
+        READ_BITS(&br, timing_info_present, 1);
+        if (timing_info_present)
+        {
+            SKIP_BITS(&br, 64); /* num_units_in_display_tick, time_scale */
+            READ_BITS(&br, val, 1);
+            if (val && !aml_v4l2_av1_skip_uvlc(&br))
+                goto error;
+
+            READ_BITS(&br, decoder_model_info_present, 1);
+            if (decoder_model_info_present)
+            {
+                READ_BITS(&br, buffer_delay_length, 5);
+                buffer_delay_length += 1;
+                SKIP_BITS(&br, 32 + 5 + 5);
+            }
+        }
+        READ_BITS(&br, initial_display_delay_present, 1);
+        READ_BITS(&br, operating_points_cnt_minus1, 5);
+        for (i = 0; i <= operating_points_cnt_minus1; i++)
+        {
+            SKIP_BITS(&br, 12); /* operating_point_idc */
+            READ_BITS(&br, val, 5);
+            if (val > 7) /* seq_level_idx */
+                SKIP_BITS(&br, 1);
+            if (decoder_model_info_present)
+            {
+                READ_BITS(&br, val, 1);
+                if (val)
+                    SKIP_BITS(&br, 2 * buffer_delay_length + 1);
+            }
+            if (initial_display_delay_present)
+            {
+                READ_BITS(&br, val, 1);
+                if (val)
+                    SKIP_BITS(&br, 4);
+            }
+        }
+    }
+
+    READ_BITS(&br, width_bits, 4);
+    READ_BITS(&br, height_bits, 4);
+    READ_BITS(&br, width, width_bits + 1);
+    READ_BITS(&br, height, height_bits + 1);
+
+    info->width = width + 1;
+    info->height = height + 1;
+    return TRUE;
+
+error:
+    return FALSE;
+}
+
+static gboolean
+aml_v4l2_parse_av1(const guint8 *data, gsize size, GstAmlV4l2CodecHeaderInfo *info)
+{
+    GstByteReader br;
+    guint8 header, obu_type;
+    guint64 obu_size;
+    const guint8 *payload;
+
+    gst_byte_reader_init(&br, data, size);
+
+    /* av1C codec_data, configOBUs follow the 4 bytes header */
+    if (size >= 4 && (data[0] & 0x80))
+        gst_byte_reader_skip(&br, 4);
+
+    while (gst_byte_reader_get_remaining(&br) > 0)
+    {
+        if (!gst_byte_reader_get_uint8(&br, &header))
+            return FALSE;
+        if (header & 0x80) /* obu_forbidden_bit */
+            return FALSE;
+
+        obu_type = (header >> 3) & 0x0f;
+        if ((header & 0x04) && !gst_byte_reader_skip(&br, 1))
+            return FALSE;
+
+        if (header & 0x02)
+        {
+            if (!aml_v4l2_read_leb128(&br, &obu_size))
+                return FALSE;
+        }
+        else
+        {
+            obu_size = gst_byte_reader_get_remaining(&br);
+        }
+
+        if (obu_size > gst_byte_reader_get_remaining(&br) ||
+            !gst_byte_reader_get_data(&br, obu_size, &payload))
+            return FALSE;
+
+        if (obu_type == AV1_OBU_SEQUENCE_HEADER)
+            return aml_v4l2_av1_parse_sequence_header(payload, obu_size, info);
+    }
+
+    return FALSE;
+}
+
+gboolean
+gst_aml_v4l2_codec_parse_header(GstCaps *caps, GstBuffer *buffer,
+                                GstAmlV4l2CodecHeaderInfo *info)
+{
+    GstStructure *s;
+    const gchar *name;
+    GstMapInfo map;
+    gboolean annexb;
+    gboolean ret = FALSE;
+
+    g_return_val_if_fail(info != NULL, FALSE);
+
+    if (!caps || !buffer || gst_caps_is_empty(caps))
+        return FALSE;
+
+    s = gst_caps_get_structure(caps, 0);
+    name = gst_structure_get_name(s);
+
+    if (!gst_buffer_map(buffer, &map, GST_MAP_READ))
+        return FALSE;
+
+    memset(info, 0, sizeof(*info));
+    annexb = map.size >= 3 && map.data[0] == 0x00 && map.data[1] == 0x00 &&
+             (map.data[2] == 0x01 || (map.size >= 4 && map.data[2] == 0x00 && map.data[3] == 0x01));
+
+    if (g_str_equal(name, "video/x-h264"))
+        ret = annexb ? aml_v4l2_parse_annexb(map.data, map.size, FALSE, aml_v4l2_h264_parse_sps, info)
+                     : aml_v4l2_parse_avcc(map.data, map.size, info);
+    else if (g_str_equal(name, "video/x-h265"))
+        ret = annexb ? aml_v4l2_parse_annexb(map.data, map.size, TRUE, aml_v4l2_hevc_parse_sps, info)
+                     : aml_v4l2_parse_hvcc(map.data, map.size, info);
+    else if (g_str_equal(name, "video/x-vp9"))
+        ret = aml_v4l2_parse_vp9(map.data, map.size, info);
+    else if (g_str_equal(name, "video/x-av1"))
+        ret = aml_v4l2_parse_av1(map.data, map.size, info);
+
+    gst_buffer_unmap(buffer, &map);
+
+    if (ret)
+        GST_DEBUG("%s header: %dx%d", name, info->width, info->height);
+    else
+        GST_LOG("no usable %s sequence header", name);
+
+    return ret;
+}
@@ -0,0 +1,49 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifndef __AML_V4L2_CODEC_PARSER_H__
+#define __AML_V4L2_CODEC_PARSER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstAmlV4l2CodecHeaderInfo GstAmlV4l2CodecHeaderInfo;
+
+/**
+ * GstAmlV4l2CodecHeaderInfo:
+ * @width: visible width in pixels
+ * @height: visible height in pixels
+ *
+ * Picture size predicted from the sequence header, before the driver
+ * reports it through V4L2_EVENT_SOURCE_CHANGE. The capture format itself
+ * (double-write layout, bit depth) and the buffer count are the driver's.
+ */
+struct _GstAmlV4l2CodecHeaderInfo
+{
+    gint width;
+    gint height;
+};
+
+gboolean gst_aml_v4l2_codec_parse_header(GstCaps *caps, GstBuffer *buffer,
+                                         GstAmlV4l2CodecHeaderInfo *info);
+
+G_END_DECLS
+
+#endif /* __AML_V4L2_CODEC_PARSER_H__ */
@@ -0,0 +1,181 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "aml-v4l2-context-cache.h"
+
+GST_DEBUG_CATEGORY_EXTERN(aml_v4l2_debug);
+#define GST_CAT_DEFAULT aml_v4l2_debug
+
+typedef struct
+{
+    gchar *videodev;
+    gboolean output;
+
+    enum v4l2_buf_type type;
+    struct v4l2_capability vcap;
+    guint32 device_caps;
+    gboolean never_interlaced;
+    GSList *formats;
+
+    gint64 expire; /* monotonic time */
+} GstAmlV4l2Context;
+
+static GMutex cache_lock;
+static GList *cache_entries = NULL;
+
+static gint64
+gst_aml_v4l2_context_cache_ttl(void)
+{
+    static gint64 ttl = -1;
+    const char *env;
+
+    if (ttl < 0)
+    {
+        env = getenv("GST_AML_V4L2_CONTEXT_CACHE_TTL");
+        ttl = env ? MAX(atoi(env), 0) * G_TIME_SPAN_MILLISECOND : 0;
+    }
+    return ttl;
+}
+
+static GSList *
+gst_aml_v4l2_context_copy_formats(GSList *formats)
+{
+    struct v4l2_fmtdesc *fmt;
+    GSList *copy = NULL;
+
+    for (; formats; formats = formats->next)
+    {
+        fmt = g_new(struct v4l2_fmtdesc, 1);
+        *fmt = *(struct v4l2_fmtdesc *)formats->data;
+        copy = g_slist_prepend(copy, fmt);
+    }
+    return g_slist_reverse(copy);
+}
+
+static void
+gst_aml_v4l2_context_free(GstAmlV4l2Context *context)
+{
+    g_slist_free_full(context->formats, g_free);
+    g_free(context->videodev);
+    g_free(context);
+}
+
+/* Called with cache_lock, drops expired entries on the way */
+static GList *
+gst_aml_v4l2_context_cache_find(GstAmlV4l2Object *v4l2object)
+{
+    GstAmlV4l2Context *context;
+    GList *l, *next, *found = NULL;
+    gint64 now = g_get_monotonic_time();
+
+    for (l = cache_entries; l; l = next)
+    {
+        context = l->data;
+        next = l->next;
+
+        if (context->expire <= now)
+        {
+            cache_entries = g_list_delete_link(cache_entries, l);
+            gst_aml_v4l2_context_free(context);
+        }
+        else if (!found && context->output == V4L2_TYPE_IS_OUTPUT(v4l2object->type) &&
+                 !strcmp(context->videodev, v4l2object->videodev))
+        {
+            found = l;
+        }
+    }
+    return found;
+}
+
+/* Fills in capabilities, buffer type and a copy of the format list of
+ * @v4l2object, which was just opened. FALSE when the device is not
+ * cached */
+gboolean
+gst_aml_v4l2_context_cache_lookup(GstAmlV4l2Object *v4l2object)
+{
+    GstAmlV4l2Context *context;
+    GList *l;
+
+    if (gst_aml_v4l2_context_cache_ttl() == 0 || !v4l2object->videodev)
+        return FALSE;
+
+    g_mutex_lock(&cache_lock);
+    l = gst_aml_v4l2_context_cache_find(v4l2object);
+    if (l)
+    {
+        context = l->data;
+        v4l2object->type = context->type;
+        v4l2object->vcap = context->vcap;
+        v4l2object->device_caps = context->device_caps;
+        v4l2object->never_interlaced = context->never_interlaced;
+
+        g_slist_free_full(v4l2object->formats, g_free);
+        v4l2object->formats = gst_aml_v4l2_context_copy_formats(context->formats);
+    }
+    g_mutex_unlock(&cache_lock);
+
+    if (l)
+        GST_DEBUG_OBJECT(v4l2object->dbg_obj, "using cached capabilities of %s",
+                         v4l2object->videodev);
+    return l != NULL;
+}
+
+/* Remembers the query results of @v4l2object before it is closed */
+void
+gst_aml_v4l2_context_cache_store(GstAmlV4l2Object *v4l2object)
+{
+    GstAmlV4l2Context *context;
+    gint64 ttl = gst_aml_v4l2_context_cache_ttl();
+    GList *l;
+
+    /* nothing to save a query for yet */
+    if (ttl == 0 || !v4l2object->videodev || !v4l2object->formats)
+        return;
+
+    context = g_new0(GstAmlV4l2Context, 1);
+    context->videodev = g_strdup(v4l2object->videodev);
+    context->output = V4L2_TYPE_IS_OUTPUT(v4l2object->type);
+    context->type = v4l2object->type;
+    context->vcap = v4l2object->vcap;
+    context->device_caps = v4l2object->device_caps;
+    context->never_interlaced = v4l2object->never_interlaced;
+    context->formats = gst_aml_v4l2_context_copy_formats(v4l2object->formats);
+    context->expire = g_get_monotonic_time() + ttl;
+
+    GST_DEBUG_OBJECT(v4l2object->dbg_obj, "caching capabilities of %s for %" G_GINT64_FORMAT " ms",
+                     context->videodev, ttl / G_TIME_SPAN_MILLISECOND);
+
+    g_mutex_lock(&cache_lock);
+    l = gst_aml_v4l2_context_cache_find(v4l2object);
+    if (l)
+    {
+        gst_aml_v4l2_context_free(l->data);
+        cache_entries = g_list_delete_link(cache_entries, l);
+    }
+    cache_entries = g_list_prepend(cache_entries, context);
+    g_mutex_unlock(&cache_lock);
+}
@@ -0,0 +1,39 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+
+#ifndef __AML_V4L2_CONTEXT_CACHE_H__
+#define __AML_V4L2_CONTEXT_CACHE_H__
+
+#include "gstamlv4l2object.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Process-wide cache of what a device reports about itself: the QUERYCAP
+ * result and the format list. The device is always opened and closed as
+ * usual, only the query sequence is skipped for a device seen in the last
+ * GST_AML_V4L2_CONTEXT_CACHE_TTL milliseconds (unset or 0: disabled).
+ */
+gboolean gst_aml_v4l2_context_cache_lookup(GstAmlV4l2Object *v4l2object);
+void gst_aml_v4l2_context_cache_store(GstAmlV4l2Object *v4l2object);
+
+G_END_DECLS
+
+#endif /* __AML_V4L2_CONTEXT_CACHE_H__ */
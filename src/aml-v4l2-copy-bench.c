@@ -0,0 +1,127 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Times gst_aml_v4l2_copy_frame() against gst_video_frame_copy() on 1080p
+ * and 4K NV12 frames in system memory. Not built by default:
+ *
+ *   make -C src aml-v4l2-copy-bench
+ *   GST_AML_V4L2_COPY_MODE=cached ./aml-v4l2-copy-bench [iterations]
+ *   GST_AML_V4L2_COPY_MODE=nontemporal ./aml-v4l2-copy-bench [iterations]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aml-v4l2-copy.h"
+
+GST_DEBUG_CATEGORY(aml_v4l2_debug);
+
+typedef gboolean (*GstAmlV4l2CopyFunc)(GstVideoFrame *dest, const GstVideoFrame *src);
+
+static gboolean
+bench_video_frame_copy(GstVideoFrame *dest, const GstVideoFrame *src)
+{
+    return gst_video_frame_copy(dest, src);
+}
+
+static gdouble
+bench_run(GstAmlV4l2CopyFunc func, GstBuffer *dest_buf, GstBuffer *src_buf,
+          GstVideoInfo *info, guint iterations)
+{
+    GstVideoFrame dest, src;
+    gint64 start, total = 0;
+    guint i;
+
+    for (i = 0; i < iterations; i++)
+    {
+        if (!gst_video_frame_map(&src, info, src_buf, GST_MAP_READ))
+            return -1;
+        if (!gst_video_frame_map(&dest, info, dest_buf, GST_MAP_WRITE))
+        {
+            gst_video_frame_unmap(&src);
+            return -1;
+        }
+
+        start = g_get_monotonic_time();
+        func(&dest, &src);
+        total += g_get_monotonic_time() - start;
+
+        gst_video_frame_unmap(&dest);
+        gst_video_frame_unmap(&src);
+    }
+
+    return (gdouble)total / iterations / 1000.0;
+}
+
+static void
+bench_size(gint width, gint height, guint iterations)
+{
+    GstVideoInfo info;
+    GstBuffer *src_buf, *dest_buf;
+    GstMapInfo map;
+    gdouble generic, aml;
+
+    gst_video_info_set_format(&info, GST_VIDEO_FORMAT_NV12, width, height);
+    src_buf = gst_buffer_new_allocate(NULL, GST_VIDEO_INFO_SIZE(&info), NULL);
+    dest_buf = gst_buffer_new_allocate(NULL, GST_VIDEO_INFO_SIZE(&info), NULL);
+
+    /* fault all pages in before timing */
+    gst_buffer_map(src_buf, &map, GST_MAP_WRITE);
+    memset(map.data, 0x80, map.size);
+    gst_buffer_unmap(src_buf, &map);
+    gst_buffer_memset(dest_buf, 0, 0, GST_VIDEO_INFO_SIZE(&info));
+
+    /* warm up the copy workers */
+    bench_run(gst_aml_v4l2_copy_frame, dest_buf, src_buf, &info, 1);
+
+    generic = bench_run(bench_video_frame_copy, dest_buf, src_buf, &info, iterations);
+    aml = bench_run(gst_aml_v4l2_copy_frame, dest_buf, src_buf, &info, iterations);
+
+    printf("NV12 %dx%d: gst_video_frame_copy %.3f ms, gst_aml_v4l2_copy_frame %.3f ms\n",
+           width, height, generic, aml);
+
+    gst_buffer_unref(dest_buf);
+    gst_buffer_unref(src_buf);
+}
+
+int
+main(int argc, char **argv)
+{
+    guint iterations = 100;
+
+    gst_init(&argc, &argv);
+    GST_DEBUG_CATEGORY_INIT(aml_v4l2_debug, "amlv4l2", 0, "aml v4l2 copy bench");
+
+    if (argc > 1 && atoi(argv[1]) > 0)
+        iterations = atoi(argv[1]);
+
+    printf("%u iterations, GST_AML_V4L2_COPY_MODE=%s\n", iterations,
+           getenv("GST_AML_V4L2_COPY_MODE") ? getenv("GST_AML_V4L2_COPY_MODE") : "cached");
+
+    bench_size(1920, 1080, iterations);
+    bench_size(3840, 2160, iterations);
+
+    return 0;
+}
@@ -0,0 +1,328 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define AML_V4L2_COPY_SSE2 1
+#endif
+
+#include "aml-v4l2-copy.h"
+
+GST_DEBUG_CATEGORY_EXTERN(aml_v4l2_debug);
+#define GST_CAT_DEFAULT aml_v4l2_debug
+
+/* below this many bytes a frame is copied by the calling thread only,
+ * 1080p NV12 is about 3 MiB */
+#define AML_V4L2_COPY_PARALLEL_MIN (4 * 1024 * 1024)
+#define AML_V4L2_COPY_MAX_THREADS 4
+#define AML_V4L2_COPY_CACHELINE 64
+#define AML_V4L2_COPY_PREFETCH 256
+
+typedef enum
+{
+    GST_AML_V4L2_COPY_MODE_CACHED,
+    GST_AML_V4L2_COPY_MODE_NONTEMPORAL,
+    GST_AML_V4L2_COPY_MODE_GENERIC
+} GstAmlV4l2CopyMode;
+
+typedef struct
+{
+    GstVideoFrame *dest;
+    const GstVideoFrame *src;
+    guint n_stripes;
+    gboolean nontemporal;
+
+    GMutex lock;
+    GCond cond;
+    guint pending;
+} GstAmlV4l2CopyBatch;
+
+typedef struct
+{
+    GstAmlV4l2CopyBatch *batch;
+    guint stripe;
+} GstAmlV4l2CopyJob;
+
+static GThreadPool *copy_workers = NULL;
+static guint copy_threads = 1;
+static GstAmlV4l2CopyMode copy_mode = GST_AML_V4L2_COPY_MODE_CACHED;
+
+/* libc memcpy already picks the widest loads and stores the cpu has, an
+ * own unrolled vector loop does the same */
+static inline void
+gst_aml_v4l2_copy_line(guint8 *dst, const guint8 *src, gsize n)
+{
+    memcpy(dst, src, n);
+}
+
+/* Write-combined and uncached destinations, only with
+ * GST_AML_V4L2_COPY_MODE=nontemporal: whole cachelines with
+ * non-temporal stores, so nothing is read back or allocated in the cache,
+ * and the source is prefetched ahead */
+static inline void
+gst_aml_v4l2_copy_line_nt(guint8 *dst, const guint8 *src, gsize n)
+{
+#if defined(__aarch64__) || defined(AML_V4L2_COPY_SSE2)
+    gsize head = (AML_V4L2_COPY_CACHELINE - ((guintptr)dst & (AML_V4L2_COPY_CACHELINE - 1))) &
+                 (AML_V4L2_COPY_CACHELINE - 1);
+
+    if (head > n)
+        head = n;
+    gst_aml_v4l2_copy_line(dst, src, head);
+    dst += head;
+    src += head;
+    n -= head;
+
+    for (; n >= AML_V4L2_COPY_CACHELINE; n -= AML_V4L2_COPY_CACHELINE,
+                                         src += AML_V4L2_COPY_CACHELINE, dst += AML_V4L2_COPY_CACHELINE)
+    {
+#if defined(__aarch64__)
+        uint8x16_t a, b, c, d;
+
+        __builtin_prefetch(src + AML_V4L2_COPY_PREFETCH, 0, 0);
+        a = vld1q_u8(src);
+        b = vld1q_u8(src + 16);
+        c = vld1q_u8(src + 32);
+        d = vld1q_u8(src + 48);
+        __asm__ volatile("stnp %q0, %q1, [%2]\n\t"
+                         "stnp %q3, %q4, [%2, #32]"
+                         :
+                         : "w"(a), "w"(b), "r"(dst), "w"(c), "w"(d)
+                         : "memory");
+#else
+        __m128i a, b, c, d;
+
+        _mm_prefetch((const char *)(src + AML_V4L2_COPY_PREFETCH), _MM_HINT_NTA);
+        a = _mm_loadu_si128((const __m128i *)src);
+        b = _mm_loadu_si128((const __m128i *)(src + 16));
+        c = _mm_loadu_si128((const __m128i *)(src + 32));
+        d = _mm_loadu_si128((const __m128i *)(src + 48));
+        _mm_stream_si128((__m128i *)dst, a);
+        _mm_stream_si128((__m128i *)(dst + 16), b);
+        _mm_stream_si128((__m128i *)(dst + 32), c);
+        _mm_stream_si128((__m128i *)(dst + 48), d);
+#endif
+    }
+#endif
+    gst_aml_v4l2_copy_line(dst, src, n);
+}
+
+static inline void
+gst_aml_v4l2_copy_fence(void)
+{
+#if defined(__aarch64__)
+    __asm__ volatile("dmb ishst" ::: "memory");
+#elif defined(AML_V4L2_COPY_SSE2)
+    _mm_sfence();
+#endif
+}
+
+static void
+gst_aml_v4l2_copy_plane_rows(GstVideoFrame *dest, const GstVideoFrame *src, guint plane,
+                             guint first, guint last, gboolean nontemporal)
+{
+    const GstVideoFormatInfo *finfo = src->info.finfo;
+    gint src_stride = GST_VIDEO_FRAME_PLANE_STRIDE(src, plane);
+    gint dest_stride = GST_VIDEO_FRAME_PLANE_STRIDE(dest, plane);
+    const guint8 *s = (const guint8 *)GST_VIDEO_FRAME_PLANE_DATA(src, plane) + (gsize)first * src_stride;
+    guint8 *d = (guint8 *)GST_VIDEO_FRAME_PLANE_DATA(dest, plane) + (gsize)first * dest_stride;
+    /* NV12, NV21 and P010 are semi-planar, component n lives in plane n */
+    gsize row_bytes = (gsize)GST_VIDEO_FORMAT_INFO_SCALE_WIDTH(finfo, plane, GST_VIDEO_FRAME_WIDTH(src)) *
+                      GST_VIDEO_FORMAT_INFO_PSTRIDE(finfo, plane);
+    guint rows = last - first;
+
+    if (rows == 0)
+        return;
+
+    /* no padding on either side, one linear copy */
+    if (src_stride == dest_stride && row_bytes == (gsize)src_stride)
+    {
+        row_bytes *= rows;
+        rows = 1;
+    }
+
+    for (; rows > 0; rows--, s += src_stride, d += dest_stride)
+    {
+        if (nontemporal)
+            gst_aml_v4l2_copy_line_nt(d, s, row_bytes);
+        else
+            gst_aml_v4l2_copy_line(d, s, row_bytes);
+    }
+}
+
+static void
+gst_aml_v4l2_copy_stripe(GstVideoFrame *dest, const GstVideoFrame *src, guint stripe,
+                         guint n_stripes, gboolean nontemporal)
+{
+    guint plane, height;
+
+    for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES(src); plane++)
+    {
+        height = GST_VIDEO_FRAME_COMP_HEIGHT(src, plane);
+        gst_aml_v4l2_copy_plane_rows(dest, src, plane, height * stripe / n_stripes,
+                                     height * (stripe + 1) / n_stripes, nontemporal);
+    }
+
+    /* streaming stores are weakly ordered, drain them before the frame is
+     * handed on */
+    if (nontemporal)
+        gst_aml_v4l2_copy_fence();
+}
+
+static void
+gst_aml_v4l2_copy_worker(gpointer data, gpointer user_data)
+{
+    GstAmlV4l2CopyJob *job = data;
+    GstAmlV4l2CopyBatch *batch = job->batch;
+
+    gst_aml_v4l2_copy_stripe(batch->dest, batch->src, job->stripe, batch->n_stripes,
+                             batch->nontemporal);
+
+    g_mutex_lock(&batch->lock);
+    if (--batch->pending == 0)
+        g_cond_signal(&batch->cond);
+    g_mutex_unlock(&batch->lock);
+}
+
+static gpointer
+gst_aml_v4l2_copy_init_workers(gpointer data)
+{
+    const char *env;
+
+    copy_threads = MIN(g_get_num_processors(), AML_V4L2_COPY_MAX_THREADS);
+    env = getenv("GST_AML_V4L2_COPY_THREADS");
+    if (env && atoi(env) > 0)
+        copy_threads = atoi(env);
+
+    /* the calling thread takes a stripe too */
+    if (copy_threads > 1)
+        copy_workers = g_thread_pool_new(gst_aml_v4l2_copy_worker, NULL,
+                                         copy_threads - 1, TRUE, NULL);
+    if (!copy_workers)
+        copy_threads = 1;
+
+    /* whether a dmabuf is mapped write-combined depends on the heap it came
+     * from and can't be queried, streaming stores into cached memory are
+     * slower than plain ones, so they are only used when asked for */
+    env = getenv("GST_AML_V4L2_COPY_MODE");
+    if (env && !strcmp(env, "nontemporal"))
+        copy_mode = GST_AML_V4L2_COPY_MODE_NONTEMPORAL;
+    else if (env && !strcmp(env, "generic"))
+        copy_mode = GST_AML_V4L2_COPY_MODE_GENERIC;
+
+    GST_INFO("frame copies use %u thread(s), mode %d", copy_threads, copy_mode);
+    return NULL;
+}
+
+static gboolean
+gst_aml_v4l2_copy_format_supported(GstVideoFormat format)
+{
+    switch (format)
+    {
+    case GST_VIDEO_FORMAT_NV12:
+    case GST_VIDEO_FORMAT_NV21:
+    case GST_VIDEO_FORMAT_P010_10LE:
+    case GST_VIDEO_FORMAT_P010_10BE:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+gboolean
+gst_aml_v4l2_copy_frame(GstVideoFrame *dest, const GstVideoFrame *src)
+{
+    static GOnce once = G_ONCE_INIT;
+    GstAmlV4l2CopyJob jobs[AML_V4L2_COPY_MAX_THREADS * 4];
+    GstAmlV4l2CopyBatch batch;
+    gboolean nontemporal;
+    guint i, n_stripes;
+    gint64 start;
+    gboolean ret = TRUE;
+
+    g_once(&once, gst_aml_v4l2_copy_init_workers, NULL);
+
+    start = g_get_monotonic_time();
+
+    if (copy_mode == GST_AML_V4L2_COPY_MODE_GENERIC ||
+        !gst_aml_v4l2_copy_format_supported(GST_VIDEO_FRAME_FORMAT(src)) ||
+        GST_VIDEO_FRAME_FORMAT(src) != GST_VIDEO_FRAME_FORMAT(dest) ||
+        GST_VIDEO_FRAME_WIDTH(src) != GST_VIDEO_FRAME_WIDTH(dest) ||
+        GST_VIDEO_FRAME_HEIGHT(src) != GST_VIDEO_FRAME_HEIGHT(dest))
+    {
+        ret = gst_video_frame_copy(dest, src);
+        nontemporal = FALSE;
+        n_stripes = 0;
+        goto done;
+    }
+
+    nontemporal = copy_mode == GST_AML_V4L2_COPY_MODE_NONTEMPORAL;
+
+    n_stripes = MIN(copy_threads, G_N_ELEMENTS(jobs));
+    if (GST_VIDEO_FRAME_SIZE(src) < AML_V4L2_COPY_PARALLEL_MIN || n_stripes < 2)
+    {
+        n_stripes = 1;
+        gst_aml_v4l2_copy_stripe(dest, src, 0, 1, nontemporal);
+        goto done;
+    }
+
+    batch.dest = dest;
+    batch.src = src;
+    batch.n_stripes = n_stripes;
+    batch.nontemporal = nontemporal;
+    batch.pending = n_stripes - 1;
+    g_mutex_init(&batch.lock);
+    g_cond_init(&batch.cond);
+
+    for (i = 1; i < n_stripes; i++)
+    {
+        jobs[i].batch = &batch;
+        jobs[i].stripe = i;
+        g_thread_pool_push(copy_workers, &jobs[i], NULL);
+    }
+
+    gst_aml_v4l2_copy_stripe(dest, src, 0, n_stripes, nontemporal);
+
+    g_mutex_lock(&batch.lock);
+    while (batch.pending > 0)
+        g_cond_wait(&batch.cond, &batch.lock);
+    g_mutex_unlock(&batch.lock);
+
+    g_mutex_clear(&batch.lock);
+    g_cond_clear(&batch.cond);
+
+done:
+    /* set GST_AML_V4L2_COPY_MODE to compare the paths on a device */
+    GST_LOG("copied %dx%d %s in %" G_GINT64_FORMAT " us, %u stripe(s)%s",
+            GST_VIDEO_FRAME_WIDTH(src), GST_VIDEO_FRAME_HEIGHT(src),
+            gst_video_format_to_string(GST_VIDEO_FRAME_FORMAT(src)),
+            g_get_monotonic_time() - start, n_stripes,
+            n_stripes == 0 ? " (gst_video_frame_copy)" : nontemporal ? " non-temporal" : "");
+
+    return ret;
+}
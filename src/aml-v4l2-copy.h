@@ -0,0 +1,46 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifndef __AML_V4L2_COPY_H__
+#define __AML_V4L2_COPY_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Frame copies for the paths that can't avoid one. NV12, NV21 and P010 are
+ * copied plane by plane, one memcpy per row or per plane when neither side
+ * is padded. Frames above a size threshold are split in row stripes over a
+ * small process-wide worker pool, sized by GST_AML_V4L2_COPY_THREADS
+ * (default: number of cpus, at most 4). Other formats use
+ * gst_video_frame_copy().
+ *
+ * GST_AML_V4L2_COPY_MODE=nontemporal writes with non-temporal cacheline
+ * stores, for platforms whose destination memory is mapped write-combined
+ * or uncached, =generic always uses gst_video_frame_copy(). The copy time
+ * of each frame is logged at LOG level, aml-v4l2-copy-bench compares the
+ * modes on a device.
+ */
+gboolean gst_aml_v4l2_copy_frame(GstVideoFrame *dest, const GstVideoFrame *src);
+
+G_END_DECLS
+
+#endif /* __AML_V4L2_COPY_H__ */
@@ -0,0 +1,122 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifndef __AML_V4L2_PTS_RING_H__
+#define __AML_V4L2_PTS_RING_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Ring of decoded pts, written by the decoder output thread and read by any
+ * number of consumers without locking. The decoder passes a pointer to it in
+ * the "pts_ring" field of its upstream "private_signal" event; the ring lives
+ * as long as the element.
+ *
+ * Each consumer keeps its own read index, starting from
+ * gst_aml_v4l2_pts_ring_tail(). The writer never waits: a consumer that falls
+ * more than GST_AML_V4L2_PTS_RING_SIZE entries behind skips the overwritten
+ * ones. Each slot carries a sequence number so a torn read is detected: the
+ * slot was overwritten by a newer entry while being read, so the entry is
+ * lost and skipped like an overrun, the read goes on with the next one. */
+
+#define GST_AML_V4L2_PTS_RING_SIZE 64 /* power of two */
+
+#define GST_AML_V4L2_PTS_RING_FLAG_KEYFRAME (1 << 0)
+#define GST_AML_V4L2_PTS_RING_FLAG_CORRUPTED (1 << 1)
+#define GST_AML_V4L2_PTS_RING_FLAG_FIELD (1 << 2)
+
+typedef struct _GstAmlV4l2PtsRing GstAmlV4l2PtsRing;
+typedef struct _GstAmlV4l2PtsRingSlot GstAmlV4l2PtsRingSlot;
+
+struct _GstAmlV4l2PtsRingSlot
+{
+    gint seq; /* (index + 1) * 2 when valid, odd while being written */
+    guint32 flags;
+    guint64 pts;
+};
+
+struct _GstAmlV4l2PtsRing
+{
+    gint head; /* index of the next slot to write */
+    GstAmlV4l2PtsRingSlot slots[GST_AML_V4L2_PTS_RING_SIZE];
+};
+
+/* single producer */
+static inline void
+gst_aml_v4l2_pts_ring_push(GstAmlV4l2PtsRing *ring, guint64 pts, guint32 flags)
+{
+    guint index = (guint)g_atomic_int_get(&ring->head);
+    GstAmlV4l2PtsRingSlot *slot = &ring->slots[index & (GST_AML_V4L2_PTS_RING_SIZE - 1)];
+
+    g_atomic_int_set(&slot->seq, (gint)(index * 2 + 1));
+    /* the odd seq is visible before any of the new data */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->pts = pts;
+    slot->flags = flags;
+    g_atomic_int_set(&slot->seq, (gint)((index + 1) * 2));
+    g_atomic_int_set(&ring->head, (gint)(index + 1));
+}
+
+static inline guint
+gst_aml_v4l2_pts_ring_tail(GstAmlV4l2PtsRing *ring)
+{
+    return (guint)g_atomic_int_get(&ring->head);
+}
+
+/* Reads the entry at *read_index and advances it. Returns FALSE when the
+ * consumer has caught up with the writer. */
+static inline gboolean
+gst_aml_v4l2_pts_ring_pop(GstAmlV4l2PtsRing *ring, guint *read_index,
+                          guint64 *pts, guint32 *flags)
+{
+    while (TRUE)
+    {
+        guint head = (guint)g_atomic_int_get(&ring->head);
+        guint index = *read_index;
+        GstAmlV4l2PtsRingSlot *slot;
+        gint seq;
+
+        if (index == head)
+            return FALSE;
+
+        /* overrun, skip to the oldest entry still available */
+        if (head - index > GST_AML_V4L2_PTS_RING_SIZE)
+            index = *read_index = head - GST_AML_V4L2_PTS_RING_SIZE;
+
+        slot = &ring->slots[index & (GST_AML_V4L2_PTS_RING_SIZE - 1)];
+        seq = g_atomic_int_get(&slot->seq);
+        *pts = slot->pts;
+        *flags = slot->flags;
+        /* the data is read before the seq is checked again */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (seq == (gint)((index + 1) * 2) && g_atomic_int_get(&slot->seq) == seq)
+        {
+            *read_index = index + 1;
+            return TRUE;
+        }
+        /* slot overwritten while reading, the entry is gone. Skip it and
+         * read on with a fresh head */
+        *read_index = index + 1;
+    }
+}
+
+G_END_DECLS
+
+#endif /* __AML_V4L2_PTS_RING_H__ */
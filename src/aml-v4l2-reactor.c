@@ -0,0 +1,362 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "aml-v4l2-reactor.h"
+
+GST_DEBUG_CATEGORY_EXTERN(aml_v4l2_debug);
+#define GST_CAT_DEFAULT aml_v4l2_debug
+
+#define REACTOR_MAX_EVENTS 32
+#define REACTOR_WAKE_ID 0
+
+struct _GstAmlV4l2ReactorSource
+{
+    gint refcount;
+    guint64 id;
+    gint fd;
+    GstAmlV4l2ReactorFunc func;
+    gpointer user_data;
+
+    GMutex lock;
+    GCond cond;
+    gboolean registered;
+    gboolean removed;
+    gboolean rearm;
+    GThread *running;
+};
+
+struct _GstAmlV4l2Reactor
+{
+    gint refcount;
+    gint epoll_fd;
+    gint wake_fd;
+    GThread *thread;
+    GThreadPool *workers;
+
+    /* id -> source, protected by lock. epoll only carries the id so that an
+     * event fetched right before a removal can never reach a freed source */
+    GMutex lock;
+    GHashTable *sources;
+    guint64 next_id;
+};
+
+static GMutex default_lock;
+static GstAmlV4l2Reactor *default_reactor = NULL;
+
+static void
+gst_aml_v4l2_reactor_source_unref(GstAmlV4l2ReactorSource *source)
+{
+    if (!g_atomic_int_dec_and_test(&source->refcount))
+        return;
+
+    g_mutex_clear(&source->lock);
+    g_cond_clear(&source->cond);
+    g_free(source);
+}
+
+static gboolean
+gst_aml_v4l2_reactor_ctl(GstAmlV4l2Reactor *reactor, GstAmlV4l2ReactorSource *source, gint op)
+{
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLPRI | EPOLLONESHOT;
+    ev.data.u64 = source->id;
+
+    if (epoll_ctl(reactor->epoll_fd, op, source->fd, &ev) < 0)
+    {
+        GST_ERROR("epoll_ctl %d on fd %d failed: %s", op, source->fd, g_strerror(errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+gst_aml_v4l2_reactor_worker(gpointer data, gpointer user_data)
+{
+    GstAmlV4l2ReactorSource *source = data;
+    GstAmlV4l2Reactor *reactor = user_data;
+    gboolean keep;
+
+    g_mutex_lock(&source->lock);
+    if (source->removed)
+        goto done;
+    source->running = g_thread_self();
+    g_mutex_unlock(&source->lock);
+
+    keep = source->func(source->user_data);
+
+    g_mutex_lock(&source->lock);
+    source->running = NULL;
+    g_cond_broadcast(&source->cond);
+    if ((keep || source->rearm) && !source->removed)
+        gst_aml_v4l2_reactor_ctl(reactor, source, EPOLL_CTL_MOD);
+    source->rearm = FALSE;
+
+done:
+    g_mutex_unlock(&source->lock);
+    gst_aml_v4l2_reactor_source_unref(source);
+}
+
+static gpointer
+gst_aml_v4l2_reactor_thread(gpointer data)
+{
+    GstAmlV4l2Reactor *reactor = data;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    GstAmlV4l2ReactorSource *source;
+    guint64 id;
+    gint i, n;
+
+    for (;;)
+    {
+        n = epoll_wait(reactor->epoll_fd, events, REACTOR_MAX_EVENTS, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            GST_ERROR("epoll_wait failed: %s", g_strerror(errno));
+            break;
+        }
+
+        g_mutex_lock(&reactor->lock);
+        for (i = 0; i < n; i++)
+        {
+            /* struct epoll_event may be packed, copy the id out */
+            id = events[i].data.u64;
+            if (id == REACTOR_WAKE_ID)
+            {
+                g_mutex_unlock(&reactor->lock);
+                goto done;
+            }
+
+            source = g_hash_table_lookup(reactor->sources, &id);
+            if (!source)
+                continue;
+
+            g_atomic_int_inc(&source->refcount);
+            g_thread_pool_push(reactor->workers, source, NULL);
+        }
+        g_mutex_unlock(&reactor->lock);
+    }
+
+done:
+    GST_DEBUG("reactor thread exit");
+    return NULL;
+}
+
+static GstAmlV4l2Reactor *
+gst_aml_v4l2_reactor_new(void)
+{
+    GstAmlV4l2Reactor *reactor;
+    struct epoll_event ev;
+    GError *err = NULL;
+
+    reactor = g_new0(GstAmlV4l2Reactor, 1);
+    reactor->refcount = 1;
+    reactor->next_id = REACTOR_WAKE_ID + 1;
+    reactor->wake_fd = -1;
+    g_mutex_init(&reactor->lock);
+    reactor->sources = g_hash_table_new(g_int64_hash, g_int64_equal);
+
+    reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor->epoll_fd < 0)
+        goto epoll_failed;
+
+    reactor->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (reactor->wake_fd < 0)
+        goto epoll_failed;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = REACTOR_WAKE_ID;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wake_fd, &ev) < 0)
+        goto epoll_failed;
+
+    /* Not bounded: a dispatch may block on the driver or downstream, with a
+     * fixed number of workers one stalled source would starve all the others.
+     * Sources are one-shot so each one occupies at most one worker, idle
+     * workers are reclaimed by GLib */
+    reactor->workers = g_thread_pool_new(gst_aml_v4l2_reactor_worker, reactor,
+                                         -1, FALSE, &err);
+    if (!reactor->workers)
+        goto workers_failed;
+
+    reactor->thread = g_thread_new("aml-v4l2-reactor", gst_aml_v4l2_reactor_thread, reactor);
+
+    GST_INFO("shared reactor started");
+    return reactor;
+
+epoll_failed:
+{
+    GST_ERROR("failed to set up reactor: %s", g_strerror(errno));
+    goto cleanup;
+}
+workers_failed:
+{
+    GST_ERROR("failed to create reactor workers: %s", err->message);
+    g_error_free(err);
+    goto cleanup;
+}
+cleanup:
+    if (reactor->wake_fd >= 0)
+        close(reactor->wake_fd);
+    if (reactor->epoll_fd >= 0)
+        close(reactor->epoll_fd);
+    g_hash_table_destroy(reactor->sources);
+    g_mutex_clear(&reactor->lock);
+    g_free(reactor);
+    return NULL;
+}
+
+GstAmlV4l2Reactor *
+gst_aml_v4l2_reactor_ref_default(void)
+{
+    GstAmlV4l2Reactor *reactor;
+
+    g_mutex_lock(&default_lock);
+    if (default_reactor)
+        default_reactor->refcount++;
+    else
+        default_reactor = gst_aml_v4l2_reactor_new();
+    reactor = default_reactor;
+    g_mutex_unlock(&default_lock);
+
+    return reactor;
+}
+
+void
+gst_aml_v4l2_reactor_unref(GstAmlV4l2Reactor *reactor)
+{
+    guint64 wake = 1;
+
+    g_mutex_lock(&default_lock);
+    if (--reactor->refcount > 0)
+    {
+        g_mutex_unlock(&default_lock);
+        return;
+    }
+    if (reactor == default_reactor)
+        default_reactor = NULL;
+    g_mutex_unlock(&default_lock);
+
+    if (write(reactor->wake_fd, &wake, sizeof(wake)) < 0)
+        GST_WARNING("failed to wake reactor thread: %s", g_strerror(errno));
+    g_thread_join(reactor->thread);
+    g_thread_pool_free(reactor->workers, FALSE, TRUE);
+
+    g_warn_if_fail(g_hash_table_size(reactor->sources) == 0);
+
+    close(reactor->wake_fd);
+    close(reactor->epoll_fd);
+    g_hash_table_destroy(reactor->sources);
+    g_mutex_clear(&reactor->lock);
+    g_free(reactor);
+
+    GST_INFO("shared reactor stopped");
+}
+
+GstAmlV4l2ReactorSource *
+gst_aml_v4l2_reactor_add(GstAmlV4l2Reactor *reactor, gint fd,
+                         GstAmlV4l2ReactorFunc func, gpointer user_data)
+{
+    GstAmlV4l2ReactorSource *source;
+
+    g_return_val_if_fail(fd >= 0, NULL);
+
+    source = g_new0(GstAmlV4l2ReactorSource, 1);
+    source->refcount = 1;
+    source->fd = fd;
+    source->func = func;
+    source->user_data = user_data;
+    g_mutex_init(&source->lock);
+    g_cond_init(&source->cond);
+
+    g_mutex_lock(&reactor->lock);
+    source->id = reactor->next_id++;
+    g_hash_table_insert(reactor->sources, &source->id, source);
+    g_mutex_unlock(&reactor->lock);
+
+    GST_DEBUG("added fd %d as source %" G_GUINT64_FORMAT, fd, source->id);
+    return source;
+}
+
+gboolean
+gst_aml_v4l2_reactor_arm(GstAmlV4l2Reactor *reactor, GstAmlV4l2ReactorSource *source)
+{
+    gboolean ret = FALSE;
+
+    g_mutex_lock(&source->lock);
+    if (source->removed)
+        goto done;
+
+    /* registering lazily keeps an idle fd from reporting EPOLLERR before the
+     * owner asked for anything */
+    if (!source->registered)
+    {
+        ret = gst_aml_v4l2_reactor_ctl(reactor, source, EPOLL_CTL_ADD);
+        source->registered = ret;
+    }
+    else if (!source->running)
+    {
+        /* while running, the worker re-arms on return */
+        ret = gst_aml_v4l2_reactor_ctl(reactor, source, EPOLL_CTL_MOD);
+    }
+    else
+    {
+        /* the dispatch may have already decided not to keep the source,
+         * make the worker re-arm it on return */
+        source->rearm = TRUE;
+        ret = TRUE;
+    }
+
+done:
+    g_mutex_unlock(&source->lock);
+    return ret;
+}
+
+void
+gst_aml_v4l2_reactor_remove(GstAmlV4l2Reactor *reactor, GstAmlV4l2ReactorSource *source)
+{
+    g_mutex_lock(&reactor->lock);
+    g_hash_table_remove(reactor->sources, &source->id);
+    g_mutex_unlock(&reactor->lock);
+
+    g_mutex_lock(&source->lock);
+    source->removed = TRUE;
+    if (source->registered)
+        epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
+
+    /* wait for a dispatch in flight, unless we are that dispatch */
+    while (source->running && source->running != g_thread_self())
+        g_cond_wait(&source->cond, &source->lock);
+    g_mutex_unlock(&source->lock);
+
+    GST_DEBUG("removed fd %d source %" G_GUINT64_FORMAT, source->fd, source->id);
+    gst_aml_v4l2_reactor_source_unref(source);
+}
@@ -0,0 +1,58 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifndef __AML_V4L2_REACTOR_H__
+#define __AML_V4L2_REACTOR_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstAmlV4l2Reactor GstAmlV4l2Reactor;
+typedef struct _GstAmlV4l2ReactorSource GstAmlV4l2ReactorSource;
+
+/**
+ * GstAmlV4l2ReactorFunc:
+ * @user_data: the data passed to gst_aml_v4l2_reactor_add()
+ *
+ * Called from a worker thread once the fd became ready. The source is
+ * registered one-shot: return %TRUE to wait for the next readiness, %FALSE
+ * to leave it disarmed until gst_aml_v4l2_reactor_arm() is called.
+ */
+typedef gboolean (*GstAmlV4l2ReactorFunc)(gpointer user_data);
+
+/*
+ * A single epoll thread shared by all decoder instances of the process.
+ * Ready sources are dispatched to a worker pool that grows on demand: a
+ * dispatch that blocks keeps its worker, the other sources go on with idle
+ * or new ones. A decoder dispatch pushes downstream, so a playing instance
+ * synchronized to the clock keeps a worker most of the time; only idle
+ * instances, and those waiting on the driver, cost no thread.
+ */
+GstAmlV4l2Reactor *gst_aml_v4l2_reactor_ref_default(void);
+void gst_aml_v4l2_reactor_unref(GstAmlV4l2Reactor *reactor);
+
+GstAmlV4l2ReactorSource *gst_aml_v4l2_reactor_add(GstAmlV4l2Reactor *reactor, gint fd,
+                                                  GstAmlV4l2ReactorFunc func, gpointer user_data);
+gboolean gst_aml_v4l2_reactor_arm(GstAmlV4l2Reactor *reactor, GstAmlV4l2ReactorSource *source);
+void gst_aml_v4l2_reactor_remove(GstAmlV4l2Reactor *reactor, GstAmlV4l2ReactorSource *source);
+
+G_END_DECLS
+
+#endif /* __AML_V4L2_REACTOR_H__ */
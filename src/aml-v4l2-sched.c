@@ -0,0 +1,191 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#include "aml-v4l2-sched.h"
+
+GST_DEBUG_CATEGORY_EXTERN(aml_v4l2_debug);
+#define GST_CAT_DEFAULT aml_v4l2_debug
+
+struct _GstAmlV4l2SchedSaved
+{
+    pid_t tid;
+    gboolean has_affinity;
+    cpu_set_t affinity;
+    int policy;
+    struct sched_param param;
+    int nice;
+    gchar name[16];
+};
+
+GType
+gst_aml_v4l2_sched_policy_get_type(void)
+{
+    static GType sched_policy = 0;
+
+    if (!sched_policy)
+    {
+        static const GEnumValue sched_policies[] = {
+            {GST_AML_V4L2_SCHED_OTHER, "SCHED_OTHER", "other"},
+            {GST_AML_V4L2_SCHED_FIFO, "SCHED_FIFO", "fifo"},
+            {GST_AML_V4L2_SCHED_RR, "SCHED_RR", "rr"},
+            {0, NULL, NULL}};
+
+        sched_policy = g_enum_register_static("GstAmlV4l2SchedPolicy", sched_policies);
+    }
+    return sched_policy;
+}
+
+gboolean
+gst_aml_v4l2_sched_params_is_default(const GstAmlV4l2SchedParams *params)
+{
+    return !params->cpu_affinity && params->policy == GST_AML_V4L2_SCHED_OTHER &&
+           params->nice == 0 && !params->thread_name;
+}
+
+void
+gst_aml_v4l2_sched_params_clear(GstAmlV4l2SchedParams *params)
+{
+    g_free(params->cpu_affinity);
+    g_free(params->thread_name);
+    memset(params, 0, sizeof(*params));
+}
+
+static gboolean
+gst_aml_v4l2_sched_parse_cpus(const gchar *list, cpu_set_t *set)
+{
+    gchar **ranges, **r;
+    gboolean ret = TRUE;
+
+    CPU_ZERO(set);
+    ranges = g_strsplit(list, ",", -1);
+    for (r = ranges; *r && ret; r++)
+    {
+        gchar *end;
+        gulong first, last;
+
+        first = last = strtoul(*r, &end, 10);
+        if (end == *r)
+        {
+            ret = FALSE;
+            break;
+        }
+        if (*end == '-')
+        {
+            gchar *start = end + 1;
+
+            last = strtoul(start, &end, 10);
+            if (end == start)
+                ret = FALSE;
+        }
+        if (*end != '\0' || last < first || last >= CPU_SETSIZE)
+            ret = FALSE;
+
+        for (; ret && first <= last; first++)
+            CPU_SET(first, set);
+    }
+    g_strfreev(ranges);
+
+    return ret && CPU_COUNT(set) > 0;
+}
+
+GstAmlV4l2SchedSaved *
+gst_aml_v4l2_sched_apply(const GstAmlV4l2SchedParams *params, GstObject *dbg_obj)
+{
+    GstAmlV4l2SchedSaved *saved;
+    struct sched_param param;
+    cpu_set_t set;
+    int err;
+
+    saved = g_new0(GstAmlV4l2SchedSaved, 1);
+    saved->tid = syscall(SYS_gettid);
+    saved->has_affinity = (sched_getaffinity(0, sizeof(cpu_set_t), &saved->affinity) == 0);
+    pthread_getschedparam(pthread_self(), &saved->policy, &saved->param);
+    errno = 0;
+    saved->nice = getpriority(PRIO_PROCESS, saved->tid);
+    prctl(PR_GET_NAME, saved->name, 0, 0, 0);
+
+    if (params->cpu_affinity)
+    {
+        if (!gst_aml_v4l2_sched_parse_cpus(params->cpu_affinity, &set))
+            GST_WARNING_OBJECT(dbg_obj, "invalid cpu list '%s'", params->cpu_affinity);
+        else if (sched_setaffinity(0, sizeof(cpu_set_t), &set) < 0)
+            GST_WARNING_OBJECT(dbg_obj, "failed to pin thread to cpus %s: %s",
+                               params->cpu_affinity, g_strerror(errno));
+    }
+
+    if (params->policy != GST_AML_V4L2_SCHED_OTHER)
+    {
+        int policy = (params->policy == GST_AML_V4L2_SCHED_FIFO) ? SCHED_FIFO : SCHED_RR;
+
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = CLAMP(params->priority, sched_get_priority_min(policy),
+                                     sched_get_priority_max(policy));
+        /* needs CAP_SYS_NICE or an RLIMIT_RTPRIO budget */
+        if ((err = pthread_setschedparam(pthread_self(), policy, &param)) != 0)
+            GST_WARNING_OBJECT(dbg_obj, "failed to set %s priority %d: %s",
+                               policy == SCHED_FIFO ? "SCHED_FIFO" : "SCHED_RR",
+                               param.sched_priority, g_strerror(err));
+    }
+    else if (params->nice != 0)
+    {
+        if (setpriority(PRIO_PROCESS, saved->tid, params->nice) < 0)
+            GST_WARNING_OBJECT(dbg_obj, "failed to set nice %d: %s", params->nice,
+                               g_strerror(errno));
+    }
+
+    if (params->thread_name)
+        prctl(PR_SET_NAME, params->thread_name, 0, 0, 0);
+
+    GST_DEBUG_OBJECT(dbg_obj, "thread %d: cpus %s, policy %d, priority %d, nice %d, name %s",
+                     saved->tid, GST_STR_NULL(params->cpu_affinity), params->policy,
+                     params->priority, params->nice, GST_STR_NULL(params->thread_name));
+
+    return saved;
+}
+
+void
+gst_aml_v4l2_sched_restore(GstAmlV4l2SchedSaved *saved)
+{
+    /* the thread goes back to the task pool, leave it as we found it */
+    if (saved->has_affinity)
+        sched_setaffinity(0, sizeof(cpu_set_t), &saved->affinity);
+    pthread_setschedparam(pthread_self(), saved->policy, &saved->param);
+    setpriority(PRIO_PROCESS, saved->tid, saved->nice);
+    prctl(PR_SET_NAME, saved->name, 0, 0, 0);
+
+    g_free(saved);
+}
@@ -0,0 +1,68 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifndef __AML_V4L2_SCHED_H__
+#define __AML_V4L2_SCHED_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_AML_V4L2_SCHED_POLICY (gst_aml_v4l2_sched_policy_get_type())
+GType gst_aml_v4l2_sched_policy_get_type(void);
+
+typedef enum
+{
+    GST_AML_V4L2_SCHED_OTHER = 0,
+    GST_AML_V4L2_SCHED_FIFO = 1,
+    GST_AML_V4L2_SCHED_RR = 2
+} GstAmlV4l2SchedPolicy;
+
+typedef struct _GstAmlV4l2SchedParams GstAmlV4l2SchedParams;
+typedef struct _GstAmlV4l2SchedSaved GstAmlV4l2SchedSaved;
+
+/**
+ * GstAmlV4l2SchedParams:
+ * @cpu_affinity: cpu list such as "4-7" or "2,6", %NULL keeps the inherited mask
+ * @policy: scheduling policy
+ * @priority: real time priority, used with FIFO and RR
+ * @nice: nice value, used with OTHER
+ * @thread_name: thread name, at most 15 characters are kept
+ *
+ * Scheduling settings for a streaming thread.
+ */
+struct _GstAmlV4l2SchedParams
+{
+    gchar *cpu_affinity;
+    GstAmlV4l2SchedPolicy policy;
+    gint priority;
+    gint nice;
+    gchar *thread_name;
+};
+
+gboolean gst_aml_v4l2_sched_params_is_default(const GstAmlV4l2SchedParams *params);
+void gst_aml_v4l2_sched_params_clear(GstAmlV4l2SchedParams *params);
+
+/* both act on the calling thread */
+GstAmlV4l2SchedSaved *gst_aml_v4l2_sched_apply(const GstAmlV4l2SchedParams *params, GstObject *dbg_obj);
+void gst_aml_v4l2_sched_restore(GstAmlV4l2SchedSaved *saved);
+
+G_END_DECLS
+
+#endif /* __AML_V4L2_SCHED_H__ */
@@ -0,0 +1,131 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "aml-v4l2-timestamp.h"
+
+GST_DEBUG_CATEGORY_EXTERN(aml_v4l2_debug);
+#define GST_CAT_DEFAULT aml_v4l2_debug
+
+void
+gst_aml_v4l2_timestamp_reset(GstAmlV4l2Timestamp *ts)
+{
+    /* the framerate belongs to the caps and survives a flush */
+    ts->base = GST_CLOCK_TIME_NONE;
+    ts->fields = 0;
+    ts->field_duration = GST_CLOCK_TIME_NONE;
+    ts->reorder_delay = GST_CLOCK_TIME_NONE;
+}
+
+void
+gst_aml_v4l2_timestamp_set_framerate(GstAmlV4l2Timestamp *ts, gint fps_n, gint fps_d)
+{
+    if (fps_n > 0 && fps_d > 0)
+    {
+        ts->fps_n = fps_n;
+        ts->fps_d = fps_d;
+    }
+    else
+    {
+        /* variable or unknown framerate, measure it from the stream */
+        ts->fps_n = 0;
+        ts->fps_d = 1;
+    }
+    GST_DEBUG("framerate %d/%d", ts->fps_n, ts->fps_d);
+}
+
+GstClockTime
+gst_aml_v4l2_timestamp_duration(GstAmlV4l2Timestamp *ts, guint fields)
+{
+    if (ts->fps_n > 0)
+        return gst_util_uint64_scale_int(fields * GST_SECOND, ts->fps_d, 2 * ts->fps_n);
+
+    if (GST_CLOCK_TIME_IS_VALID(ts->field_duration))
+        return fields * ts->field_duration;
+
+    return GST_CLOCK_TIME_NONE;
+}
+
+/* Timestamp expected for the next output, without consuming it */
+GstClockTime
+gst_aml_v4l2_timestamp_peek(GstAmlV4l2Timestamp *ts)
+{
+    GstClockTime duration;
+
+    if (!GST_CLOCK_TIME_IS_VALID(ts->base))
+        return GST_CLOCK_TIME_NONE;
+
+    duration = gst_aml_v4l2_timestamp_duration(ts, ts->fields);
+    if (!GST_CLOCK_TIME_IS_VALID(duration))
+        return GST_CLOCK_TIME_NONE;
+
+    return ts->base + duration;
+}
+
+/* Returns the timestamp of an output covering @fields field periods. A valid
+ * @pts is returned as is and becomes the new baseline. Without one the
+ * timestamp is extrapolated from the baseline, or inferred from @dts plus
+ * the reorder delay seen so far. GST_CLOCK_TIME_NONE is only returned when
+ * nothing is known yet. */
+GstClockTime
+gst_aml_v4l2_timestamp_next(GstAmlV4l2Timestamp *ts, GstClockTime pts,
+                            GstClockTime dts, guint fields)
+{
+    GstClockTime out;
+
+    if (GST_CLOCK_TIME_IS_VALID(pts))
+    {
+        if (GST_CLOCK_TIME_IS_VALID(dts) && pts >= dts &&
+            (!GST_CLOCK_TIME_IS_VALID(ts->reorder_delay) || pts - dts < ts->reorder_delay))
+            ts->reorder_delay = pts - dts;
+
+        if (ts->fps_n == 0 && GST_CLOCK_TIME_IS_VALID(ts->base) && ts->fields > 0 && pts > ts->base)
+            ts->field_duration = (pts - ts->base) / ts->fields;
+
+        ts->base = pts;
+        ts->fields = fields;
+        return pts;
+    }
+
+    out = gst_aml_v4l2_timestamp_peek(ts);
+    if (GST_CLOCK_TIME_IS_VALID(out))
+    {
+        ts->fields += fields;
+        GST_LOG("extrapolated %" GST_TIME_FORMAT, GST_TIME_ARGS(out));
+        return out;
+    }
+
+    if (GST_CLOCK_TIME_IS_VALID(dts))
+    {
+        out = dts;
+        if (GST_CLOCK_TIME_IS_VALID(ts->reorder_delay))
+            out += ts->reorder_delay;
+
+        ts->base = out;
+        ts->fields = fields;
+        GST_LOG("inferred %" GST_TIME_FORMAT " from dts %" GST_TIME_FORMAT,
+                GST_TIME_ARGS(out), GST_TIME_ARGS(dts));
+        return out;
+    }
+
+    return GST_CLOCK_TIME_NONE;
+}
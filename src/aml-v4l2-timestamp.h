@@ -0,0 +1,62 @@
+/* GStreamer
+ * Copyright (C) 2022 <xuesong.jiang@amlogic.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+#ifndef __AML_V4L2_TIMESTAMP_H__
+#define __AML_V4L2_TIMESTAMP_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstAmlV4l2Timestamp GstAmlV4l2Timestamp;
+
+/**
+ * GstAmlV4l2Timestamp:
+ *
+ * Reconstructs output timestamps the decoder did not provide. Missing
+ * timestamps are computed from the last real one plus an exact number of
+ * field periods, so no rounding error accumulates between real timestamps.
+ * All durations are counted in fields, a progressive frame counts as two.
+ */
+struct _GstAmlV4l2Timestamp
+{
+    gint fps_n;
+    gint fps_d;
+
+    /* last real timestamp and field periods elapsed since */
+    GstClockTime base;
+    guint64 fields;
+
+    /* field duration measured from real timestamps, when no framerate */
+    GstClockTime field_duration;
+
+    /* smallest pts - dts seen, the reorder delay of the stream */
+    GstClockTime reorder_delay;
+};
+
+void gst_aml_v4l2_timestamp_reset(GstAmlV4l2Timestamp *ts);
+void gst_aml_v4l2_timestamp_set_framerate(GstAmlV4l2Timestamp *ts, gint fps_n, gint fps_d);
+GstClockTime gst_aml_v4l2_timestamp_duration(GstAmlV4l2Timestamp *ts, guint fields);
+GstClockTime gst_aml_v4l2_timestamp_peek(GstAmlV4l2Timestamp *ts);
+GstClockTime gst_aml_v4l2_timestamp_next(GstAmlV4l2Timestamp *ts, GstClockTime pts,
+                                         GstClockTime dts, guint fields);
+
+G_END_DECLS
+
+#endif /* __AML_V4L2_TIMESTAMP_H__ */
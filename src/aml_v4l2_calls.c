@@ -31,6 +31,7 @@
 #include <unistd.h>
 #include "gstamlv4l2object.h"
 #include "gstamlv4l2videodec.h"
+#include "aml-v4l2-context-cache.h"
 
 #include "gst/gst-i18n-plugin.h"
 
@@ -250,13 +251,18 @@ gst_aml_v4l2_open(GstAmlV4l2Object *v4l2object)
        a v4l2 device. */
 
 
-    /* get capabilities, error will be posted */
-    if (!gst_aml_v4l2_get_capabilities(v4l2object))
-        goto error;
+    /* capabilities and formats of a decoder opened before are cached */
+    if (!GST_IS_AML_V4L2_VIDEO_DEC(v4l2object->element) ||
+        !gst_aml_v4l2_context_cache_lookup(v4l2object))
+    {
+        /* get capabilities, error will be posted */
+        if (!gst_aml_v4l2_get_capabilities(v4l2object))
+            goto error;
 
-    if (GST_IS_AML_V4L2_VIDEO_DEC(v4l2object->element) &&
-        !GST_AML_V4L2_IS_M2M(v4l2object->device_caps))
-        goto not_m2m;
+        if (GST_IS_AML_V4L2_VIDEO_DEC(v4l2object->element) &&
+            !GST_AML_V4L2_IS_M2M(v4l2object->device_caps))
+            goto not_m2m;
+    }
 
     gst_aml_v4l2_adjust_buf_type(v4l2object);
 
@@ -279,6 +285,7 @@ gst_aml_v4l2_open(GstAmlV4l2Object *v4l2object)
     if (GST_IS_AML_V4L2_VIDEO_DEC(v4l2object->element))
     {
         gst_aml_v4l2_subscribe_event(v4l2object);
+        v4l2object->owns_context = TRUE;
     }
 
     /* UVC devices are never interlaced, and doing VIDIOC_TRY_FMT on them
@@ -413,9 +420,13 @@ gst_aml_v4l2_close(GstAmlV4l2Object *v4l2object)
     GST_AML_V4L2_CHECK_OPEN(v4l2object);
     GST_AML_V4L2_CHECK_NOT_ACTIVE(v4l2object);
 
+    if (v4l2object->owns_context)
+        gst_aml_v4l2_context_cache_store(v4l2object);
+
     /* close device */
     v4l2object->close(v4l2object->video_fd);
     v4l2object->video_fd = -1;
+    v4l2object->owns_context = FALSE;
 
     /* empty lists */
     gst_aml_v4l2_empty_lists(v4l2object);
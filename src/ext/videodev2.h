@@ -894,15 +894,22 @@ struct v4l2_requestbuffers
     __u32 type;   /* enum v4l2_buf_type */
     __u32 memory; /* enum v4l2_memory */
     __u32 capabilities;
-    __u32 reserved[1];
+    __u8 flags;
+    __u8 reserved[3];
 };
 
+#define V4L2_MEMORY_FLAG_NON_COHERENT (1 << 0)
+
 /* capabilities for struct v4l2_requestbuffers and v4l2_create_buffers */
 #define V4L2_BUF_CAP_SUPPORTS_MMAP (1 << 0)
 #define V4L2_BUF_CAP_SUPPORTS_USERPTR (1 << 1)
 #define V4L2_BUF_CAP_SUPPORTS_DMABUF (1 << 2)
 #define V4L2_BUF_CAP_SUPPORTS_REQUESTS (1 << 3)
 #define V4L2_BUF_CAP_SUPPORTS_ORPHANED_BUFS (1 << 4)
+#define V4L2_BUF_CAP_SUPPORTS_M2M_HOLD_CAPTURE_BUF (1 << 5)
+#define V4L2_BUF_CAP_SUPPORTS_MMAP_CACHE_HINTS (1 << 6)
+#define V4L2_BUF_CAP_SUPPORTS_MAX_NUM_BUFFERS (1 << 7)
+#define V4L2_BUF_CAP_SUPPORTS_REMOVE_BUFS (1 << 8)
 
 /**
  * struct v4l2_plane - plane info for multi-planar buffers
@@ -2460,7 +2467,23 @@ struct v4l2_create_buffers
     __u32 memory;
     struct v4l2_format format;
     __u32 capabilities;
-    __u32 reserved[7];
+    __u32 flags;
+    __u32 reserved[6];
+};
+
+/**
+ * struct v4l2_remove_buffers - VIDIOC_REMOVE_BUFS argument
+ * @index:	the first buffer to be removed
+ * @count:	number of buffers to removed
+ * @type:	enum v4l2_buf_type
+ * @reserved:	future extensions
+ */
+struct v4l2_remove_buffers
+{
+    __u32 index;
+    __u32 count;
+    __u32 type;
+    __u32 reserved[13];
 };
 
 /*
@@ -2562,6 +2585,7 @@ struct v4l2_create_buffers
 #define VIDIOC_DBG_G_CHIP_INFO _IOWR('V', 102, struct v4l2_dbg_chip_info)
 
 #define VIDIOC_QUERY_EXT_CTRL _IOWR('V', 103, struct v4l2_query_ext_ctrl)
+#define VIDIOC_REMOVE_BUFS _IOWR('V', 104, struct v4l2_remove_buffers)
 
 /* Reminder: when adding new ioctls please add support for them to
    drivers/media/v4l2-core/v4l2-compat-ioctl32.c as well! */
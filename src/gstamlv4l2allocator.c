@@ -487,6 +487,9 @@ gst_aml_v4l2_allocator_finalize(GObject *obj)
     gst_atomic_queue_unref(allocator->free_queue);
     gst_object_unref(allocator->obj->element);
 
+    if (allocator->free_notify)
+        allocator->free_notify(allocator->free_notify_data);
+
     G_OBJECT_CLASS(parent_class)->finalize(obj);
 }
 
@@ -565,6 +568,12 @@ gst_aml_v4l2_allocator_probe(GstAmlV4l2Allocator *allocator, guint32 memory,
         GST_ERROR_OBJECT(allocator, "v4l2 support GST_V4L2_ALLOCATOR_FLAG_SUPPORTS_ORPHANED_BUFS");
     }
 
+    if (memory == V4L2_MEMORY_MMAP && (breq.capabilities & V4L2_BUF_CAP_SUPPORTS_MMAP_CACHE_HINTS))
+        flags |= GST_V4L2_ALLOCATOR_FLAG_SUPPORTS_CACHE_HINTS;
+
+    if (breq.capabilities & V4L2_BUF_CAP_SUPPORTS_REMOVE_BUFS)
+        flags |= GST_V4L2_ALLOCATOR_FLAG_SUPPORTS_REMOVE_BUFS;
+
     return flags;
 }
 
@@ -586,6 +595,7 @@ gst_aml_v4l2_allocator_create_buf(GstAmlV4l2Allocator *allocator)
     bcreate.memory = allocator->memory;
     bcreate.format = obj->format;
     bcreate.count = 1;
+    bcreate.flags = allocator->memory_flags;
 
     if (!allocator->can_allocate)
         goto done;
@@ -703,6 +713,7 @@ gst_aml_v4l2_allocator_new(GstObject *parent, GstAmlV4l2Object *v4l2object)
 
     /* Save everything */
     allocator->obj = v4l2object;
+    allocator->cpu_access = TRUE;
 
     /* Keep a ref on the elemnt so obj does not disapear */
     gst_object_ref(allocator->obj->element);
@@ -745,6 +756,12 @@ guint gst_aml_v4l2_allocator_start(GstAmlV4l2Allocator *allocator, guint32 count
     if (GST_AML_V4L2_ALLOCATOR_IS_ORPHANED(allocator))
         goto orphaned;
 
+    /* Buffers the CPU never touches can be cacheable, QBUF then skips the
+     * maintenance on them */
+    if (memory == V4L2_MEMORY_MMAP && !allocator->cpu_access &&
+        GST_AML_V4L2_ALLOCATOR_CAN_CACHE_HINTS(allocator))
+        breq.flags = V4L2_MEMORY_FLAG_NON_COHERENT;
+
     if (obj->ioctl(obj->video_fd, VIDIOC_REQBUFS, &breq) < 0)
         goto reqbufs_failed;
 
@@ -773,6 +790,7 @@ guint gst_aml_v4l2_allocator_start(GstAmlV4l2Allocator *allocator, guint32 count
     allocator->can_allocate = can_allocate;
     allocator->count = breq.count;
     allocator->memory = memory;
+    allocator->memory_flags = breq.flags;
 
     /* Create memory groups */
     for (i = 0; i < allocator->count; i++)
@@ -870,13 +888,26 @@ done:
     return ret;
 }
 
+gboolean
+gst_aml_v4l2_allocator_can_orphan(GstAmlV4l2Allocator *allocator)
+{
+    if (GST_AML_V4L2_ALLOCATOR_CAN_ORPHAN_BUFS(allocator))
+        return TRUE;
+
+    /* Imported memory belongs to its exporter, the queue only holds a
+     * reference that REQBUFS(0) drops even on drivers that can't orphan
+     * their own MMAP buffers. The outstanding buffers keep the memory. */
+    return allocator->memory == V4L2_MEMORY_DMABUF ||
+           allocator->memory == V4L2_MEMORY_USERPTR;
+}
+
 gboolean
 gst_aml_v4l2_allocator_orphan(GstAmlV4l2Allocator *allocator)
 {
     GstAmlV4l2Object *obj = allocator->obj;
     struct v4l2_requestbuffers breq = {0, obj->type, allocator->memory};
 
-    if (!GST_AML_V4L2_ALLOCATOR_CAN_ORPHAN_BUFS(allocator))
+    if (!gst_aml_v4l2_allocator_can_orphan(allocator))
         return FALSE;
 
     GST_OBJECT_FLAG_SET(allocator, GST_V4L2_ALLOCATOR_FLAG_ORPHANED);
@@ -885,12 +916,114 @@ gst_aml_v4l2_allocator_orphan(GstAmlV4l2Allocator *allocator)
     {
         GST_ERROR_OBJECT(allocator,
                          "error orphaning buffers buffers: %s", g_strerror(errno));
+        GST_OBJECT_FLAG_UNSET(allocator, GST_V4L2_ALLOCATOR_FLAG_ORPHANED);
         return FALSE;
     }
 
     return TRUE;
 }
 
+/**
+ * gst_aml_v4l2_allocator_set_cpu_access:
+ * @allocator: the allocator
+ * @cpu_access: whether the CPU may map capture buffers
+ *
+ * When nothing maps the capture buffers (no copy, no dump, downstream
+ * only imports the dmabuf), QBUF sets V4L2_BUF_FLAG_NO_CACHE_INVALIDATE and
+ * V4L2_BUF_FLAG_NO_CACHE_CLEAN, and MMAP buffers are requested non coherent
+ * when the driver allows cache hints. Takes effect on the next start.
+ */
+void
+gst_aml_v4l2_allocator_set_cpu_access(GstAmlV4l2Allocator *allocator, gboolean cpu_access)
+{
+    GST_DEBUG_OBJECT(allocator, "cpu access %d", cpu_access);
+    allocator->cpu_access = cpu_access;
+}
+
+/* @notify is called with @data when the allocator is finalized, its object
+ * may be freed from there. Orphaned allocators can outlive the element's use
+ * of the object by far. */
+void
+gst_aml_v4l2_allocator_set_free_notify(GstAmlV4l2Allocator *allocator, GDestroyNotify notify,
+                                       gpointer data)
+{
+    allocator->free_notify = notify;
+    allocator->free_notify_data = data;
+}
+
+/* Give back the buffer with the highest index, so that groups[] stays
+ * contiguous. It can only go once all its memories are back in the free
+ * queue, GST_V4L2_BUSY is returned otherwise. */
+GstAmlV4l2Return
+gst_aml_v4l2_allocator_remove_last(GstAmlV4l2Allocator *allocator)
+{
+    GstAmlV4l2Object *obj = allocator->obj;
+    struct v4l2_remove_buffers bremove = {0};
+    GstAmlV4l2MemoryGroup *group, *last;
+    GstAmlV4l2Return ret = GST_AML_V4L2_ERROR;
+    gboolean found = FALSE;
+    gint i, n;
+
+    GST_OBJECT_LOCK(allocator);
+
+    if (!g_atomic_int_get(&allocator->active) || allocator->count <= 1)
+        goto done;
+
+    if (!GST_AML_V4L2_ALLOCATOR_CAN_REMOVE_BUFS(allocator) ||
+        GST_AML_V4L2_ALLOCATOR_IS_ORPHANED(allocator))
+        goto done;
+
+    last = allocator->groups[allocator->count - 1];
+
+    n = gst_atomic_queue_length(allocator->free_queue);
+    for (i = 0; i < n; i++)
+    {
+        group = gst_atomic_queue_pop(allocator->free_queue);
+        if (group == last)
+            found = TRUE;
+        else
+            gst_atomic_queue_push(allocator->free_queue, group);
+    }
+
+    if (!found)
+        goto busy;
+
+    bremove.index = last->buffer.index;
+    bremove.count = 1;
+    bremove.type = obj->type;
+
+    if (obj->ioctl(obj->video_fd, VIDIOC_REMOVE_BUFS, &bremove) < 0)
+        goto remove_bufs_failed;
+
+    allocator->groups[bremove.index] = NULL;
+    allocator->count--;
+
+    GST_OBJECT_UNLOCK(allocator);
+
+    GST_DEBUG_OBJECT(allocator, "removed buffer %u, %u left", bremove.index,
+                     allocator->count);
+    gst_aml_v4l2_memory_group_free(last);
+
+    return GST_V4L2_OK;
+
+remove_bufs_failed:
+{
+    GST_WARNING_OBJECT(allocator, "error removing buffer %u: %s",
+                       bremove.index, g_strerror(errno));
+    gst_atomic_queue_push(allocator->free_queue, last);
+    goto done;
+}
+busy:
+{
+    GST_LOG_OBJECT(allocator, "buffer %u still in use", last->buffer.index);
+    ret = GST_V4L2_BUSY;
+    goto done;
+}
+done:
+    GST_OBJECT_UNLOCK(allocator);
+    return ret;
+}
+
 GstAmlV4l2MemoryGroup *
 gst_aml_v4l2_allocator_alloc_mmap(GstAmlV4l2Allocator *allocator)
 {
@@ -1373,6 +1506,14 @@ gst_aml_v4l2_allocator_qbuf(GstAmlV4l2Allocator *allocator,
 
     gst_aml_v4l2_allocator_dump_es_buf(allocator, group);
 
+    if (!V4L2_TYPE_IS_OUTPUT(obj->type))
+    {
+        if (allocator->cpu_access)
+            group->buffer.flags &= ~(V4L2_BUF_FLAG_NO_CACHE_INVALIDATE | V4L2_BUF_FLAG_NO_CACHE_CLEAN);
+        else
+            group->buffer.flags |= V4L2_BUF_FLAG_NO_CACHE_INVALIDATE | V4L2_BUF_FLAG_NO_CACHE_CLEAN;
+    }
+
     if (obj->ioctl(obj->video_fd, VIDIOC_QBUF, &group->buffer) < 0)
     {
         GST_ERROR_OBJECT(allocator, "failed queueing buffer %i: %s",
@@ -42,6 +42,10 @@ G_BEGIN_DECLS
     (GST_OBJECT_FLAG_IS_SET(obj, GST_V4L2_ALLOCATOR_FLAG_SUPPORTS_ORPHANED_BUFS))
 #define GST_AML_V4L2_ALLOCATOR_IS_ORPHANED(obj) \
     (GST_OBJECT_FLAG_IS_SET(obj, GST_V4L2_ALLOCATOR_FLAG_ORPHANED))
+#define GST_AML_V4L2_ALLOCATOR_CAN_CACHE_HINTS(obj) \
+    (GST_OBJECT_FLAG_IS_SET(obj, GST_V4L2_ALLOCATOR_FLAG_SUPPORTS_CACHE_HINTS))
+#define GST_AML_V4L2_ALLOCATOR_CAN_REMOVE_BUFS(obj) \
+    (GST_OBJECT_FLAG_IS_SET(obj, GST_V4L2_ALLOCATOR_FLAG_SUPPORTS_REMOVE_BUFS))
 
 #define GST_AML_V4L2_MEMORY_QUARK gst_aml_v4l2_memory_quark()
 
@@ -62,6 +66,8 @@ enum _GstAmlV4l2AllocatorFlags
     GST_V4L2_ALLOCATOR_FLAG_DMABUF_CREATE_BUFS = (GST_ALLOCATOR_FLAG_LAST << 5),
     GST_V4L2_ALLOCATOR_FLAG_SUPPORTS_ORPHANED_BUFS = (GST_ALLOCATOR_FLAG_LAST << 6),
     GST_V4L2_ALLOCATOR_FLAG_ORPHANED = (GST_ALLOCATOR_FLAG_LAST << 7),
+    GST_V4L2_ALLOCATOR_FLAG_SUPPORTS_CACHE_HINTS = (GST_ALLOCATOR_FLAG_LAST << 8),
+    GST_V4L2_ALLOCATOR_FLAG_SUPPORTS_REMOVE_BUFS = (GST_ALLOCATOR_FLAG_LAST << 9),
 };
 
 enum _GstAmlV4l2Return
@@ -95,12 +101,18 @@ struct _GstAmlV4l2Allocator
     GstAmlV4l2Object *obj;
     guint32 count;
     guint32 memory;
+    guint32 memory_flags; /* V4L2_MEMORY_FLAG_* given to REQBUFS */
     gboolean can_allocate;
     gboolean active;
+    gboolean cpu_access; /* CPU maps capture buffers, keep cache maintenance */
 
     GstAmlV4l2MemoryGroup *groups[VIDEO_MAX_FRAME];
     GstAtomicQueue *free_queue;
     GstAtomicQueue *pending_queue;
+
+    /* called from finalize, once nothing uses obj anymore */
+    GDestroyNotify free_notify;
+    gpointer free_notify_data;
 };
 
 struct _GstAmlV4l2AllocatorClass
@@ -125,8 +137,17 @@ guint gst_aml_v4l2_allocator_start(GstAmlV4l2Allocator *allocator,
 
 GstAmlV4l2Return gst_aml_v4l2_allocator_stop(GstAmlV4l2Allocator *allocator);
 
+gboolean gst_aml_v4l2_allocator_can_orphan(GstAmlV4l2Allocator *allocator);
+
 gboolean gst_aml_v4l2_allocator_orphan(GstAmlV4l2Allocator *allocator);
 
+void gst_aml_v4l2_allocator_set_cpu_access(GstAmlV4l2Allocator *allocator, gboolean cpu_access);
+
+void gst_aml_v4l2_allocator_set_free_notify(GstAmlV4l2Allocator *allocator, GDestroyNotify notify,
+                                            gpointer data);
+
+GstAmlV4l2Return gst_aml_v4l2_allocator_remove_last(GstAmlV4l2Allocator *allocator);
+
 GstAmlV4l2MemoryGroup *gst_aml_v4l2_allocator_alloc_mmap(GstAmlV4l2Allocator *allocator);
 
 GstAmlV4l2MemoryGroup *gst_aml_v4l2_allocator_alloc_dmabuf(GstAmlV4l2Allocator *allocator,
@@ -24,6 +24,7 @@
 #include <fcntl.h>
 
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdio.h>
@@ -36,12 +37,16 @@
 #include <gstamlv4l2bufferpool.h>
 
 #include "gstamlv4l2object.h"
+#include "aml-v4l2-copy.h"
 #include "gst/gst-i18n-plugin.h"
 #include <gst/glib-compat-private.h>
 
 #define GST_DUMP_CAPTURE_BP_STAT_FILENAME "amlv4l2dec_capture_bp_buf_stat"
 #define GST_DUMP_OUTPUT_BP_STAT_FILENAME "amlv4l2dec_output_bp_buf_stat"
 
+/* frames over which the elastic pool looks for unused capture buffers */
+#define GST_AML_V4L2_ELASTIC_WINDOW 300
+
 GST_DEBUG_CATEGORY_STATIC(amlv4l2bufferpool_debug);
 GST_DEBUG_CATEGORY_STATIC(CAT_PERFORMANCE);
 #define GST_CAT_DEFAULT amlv4l2bufferpool_debug
@@ -134,7 +139,7 @@ gst_aml_v4l2_buffer_pool_copy_buffer(GstAmlV4l2BufferPool *pool, GstBuffer *dest
             goto invalid_buffer;
         }
 
-        gst_video_frame_copy(&dest_frame, &src_frame);
+        gst_aml_v4l2_copy_frame(&dest_frame, &src_frame);
 
         gst_video_frame_unmap(&src_frame);
         gst_video_frame_unmap(&dest_frame);
@@ -168,12 +173,106 @@ invalid_buffer:
 }
 }
 
+static gboolean
+gst_aml_v4l2_buffer_pool_copy_meta(GstBuffer *buffer, GstMeta **meta, gpointer user_data)
+{
+    GstBuffer *dest = user_data;
+    const GstMetaInfo *info = (*meta)->info;
+    GstMetaTransformCopy copy_data = {FALSE, 0, -1};
+
+    /* the staging buffer has a video meta describing its own layout */
+    if (info->api == GST_VIDEO_META_API_TYPE || !info->transform_func)
+        return TRUE;
+
+    info->transform_func(dest, *meta, buffer,
+                         g_quark_from_static_string(GST_META_TRANSFORM_COPY), &copy_data);
+    return TRUE;
+}
+
+/* Copies a capture buffer into a buffer of the staging pool so that @buf can
+ * go back to the driver. Returns NULL if that is not possible, the caller
+ * then falls back to a deep copy */
+static GstBuffer *
+gst_aml_v4l2_buffer_pool_copy_to_staging(GstAmlV4l2BufferPool *pool, GstBuffer *buf)
+{
+    GstVideoFrame src_frame, dest_frame;
+    GstBuffer *copy = NULL;
+    GstStructure *config;
+    GstCaps *caps;
+
+    if (GST_VIDEO_INFO_FORMAT(&pool->caps_info) == GST_VIDEO_FORMAT_UNKNOWN ||
+        GST_VIDEO_INFO_FORMAT(&pool->caps_info) == GST_VIDEO_FORMAT_ENCODED)
+        return NULL;
+
+    if (!pool->staging_pool)
+    {
+        pool->staging_pool = gst_video_buffer_pool_new();
+
+        caps = gst_video_info_to_caps(&pool->caps_info);
+        config = gst_buffer_pool_get_config(pool->staging_pool);
+        gst_buffer_pool_config_set_params(config, caps, GST_VIDEO_INFO_SIZE(&pool->caps_info), 0, 0);
+        gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+        gst_caps_unref(caps);
+
+        if (!gst_buffer_pool_set_config(pool->staging_pool, config) ||
+            !gst_buffer_pool_set_active(pool->staging_pool, TRUE))
+            goto staging_failed;
+
+        GST_DEBUG_OBJECT(pool, "created staging pool %" GST_PTR_FORMAT, pool->staging_pool);
+    }
+
+    if (gst_buffer_pool_acquire_buffer(pool->staging_pool, &copy, NULL) != GST_FLOW_OK)
+        return NULL;
+
+    if (!gst_video_frame_map(&src_frame, &pool->caps_info, buf, GST_MAP_READ))
+        goto map_failed;
+
+    if (!gst_video_frame_map(&dest_frame, &pool->caps_info, copy, GST_MAP_WRITE))
+    {
+        gst_video_frame_unmap(&src_frame);
+        goto map_failed;
+    }
+
+    gst_aml_v4l2_copy_frame(&dest_frame, &src_frame);
+
+    gst_video_frame_unmap(&src_frame);
+    gst_video_frame_unmap(&dest_frame);
+
+    gst_buffer_copy_into(copy, buf, GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+    gst_buffer_foreach_meta(buf, gst_aml_v4l2_buffer_pool_copy_meta, copy);
+
+    return copy;
+
+staging_failed:
+{
+    GST_WARNING_OBJECT(pool, "failed to set up the staging pool");
+    gst_object_unref(pool->staging_pool);
+    pool->staging_pool = NULL;
+    return NULL;
+}
+map_failed:
+{
+    GST_WARNING_OBJECT(pool, "could not map buffers for the staging copy");
+    gst_buffer_unref(copy);
+    return NULL;
+}
+}
+
 struct UserPtrData
 {
     GstBuffer *buffer;
     gboolean is_frame;
     GstVideoFrame frame;
     GstMapInfo map;
+
+    /* layout validated for this index, kept across imports. A downstream
+     * buffer coming back with the same planes skips the size computation
+     * and the contiguity check */
+    gboolean layout_valid;
+    GstBuffer *layout_buffer; /* identity only, no ref */
+    gpointer layout_data[GST_VIDEO_MAX_PLANES];
+    gint layout_stride[GST_VIDEO_MAX_PLANES];
+    gsize layout_size[GST_VIDEO_MAX_PLANES];
 };
 
 static GQuark
@@ -197,8 +296,25 @@ _unmap_userptr_frame(struct UserPtrData *data)
 
     if (data->buffer)
         gst_buffer_unref(data->buffer);
+    data->buffer = NULL;
+}
+
+static gboolean
+gst_aml_v4l2_buffer_pool_userptr_layout_cached(struct UserPtrData *data, GstBuffer *src,
+                                               const GstVideoFormatInfo *finfo)
+{
+    gint i;
+
+    if (!data->layout_valid || data->layout_buffer != src)
+        return FALSE;
 
-    g_slice_free(struct UserPtrData, data);
+    for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_PLANES(finfo); i++)
+    {
+        if (data->layout_data[i] != data->frame.data[i] ||
+            data->layout_stride[i] != GST_VIDEO_FRAME_PLANE_STRIDE(&data->frame, i))
+            return FALSE;
+    }
+    return TRUE;
 }
 
 static GstFlowReturn
@@ -222,14 +338,12 @@ gst_aml_v4l2_buffer_pool_import_userptr(GstAmlV4l2BufferPool *pool,
     else
         flags = GST_MAP_WRITE;
 
-    data = g_slice_new0(struct UserPtrData);
+    data = &pool->userptr_data[group->buffer.index];
 
     if (finfo && (finfo->format != GST_VIDEO_FORMAT_UNKNOWN &&
                   finfo->format != GST_VIDEO_FORMAT_ENCODED))
     {
-        gsize size[GST_VIDEO_MAX_PLANES] = {
-            0,
-        };
+        gsize *size = data->layout_size;
         gint i;
 
         data->is_frame = TRUE;
@@ -237,6 +351,12 @@ gst_aml_v4l2_buffer_pool_import_userptr(GstAmlV4l2BufferPool *pool,
         if (!gst_video_frame_map(&data->frame, &pool->caps_info, src, flags))
             goto invalid_buffer;
 
+        if (gst_aml_v4l2_buffer_pool_userptr_layout_cached(data, src, finfo))
+            goto import;
+
+        data->layout_valid = FALSE;
+        memset(data->layout_size, 0, sizeof(data->layout_size));
+
         for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_PLANES(finfo); i++)
         {
             if (GST_VIDEO_FORMAT_INFO_IS_TILED(finfo))
@@ -279,6 +399,15 @@ gst_aml_v4l2_buffer_pool_import_userptr(GstAmlV4l2BufferPool *pool,
             }
         }
 
+        data->layout_valid = TRUE;
+        data->layout_buffer = src;
+        for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_PLANES(finfo); i++)
+        {
+            data->layout_data[i] = data->frame.data[i];
+            data->layout_stride[i] = GST_VIDEO_FRAME_PLANE_STRIDE(&data->frame, i);
+        }
+
+    import:
         if (!gst_aml_v4l2_allocator_import_userptr(pool->vallocator, group,
                                                    data->frame.info.size, finfo->n_planes, data->frame.data, size))
             goto import_failed;
@@ -319,7 +448,6 @@ not_our_buffer:
 invalid_buffer:
 {
     GST_ERROR_OBJECT(pool, "could not map buffer");
-    g_slice_free(struct UserPtrData, data);
     return GST_FLOW_ERROR;
 }
 non_contiguous_mem:
@@ -391,6 +519,123 @@ import_failed:
 }
 }
 
+/* The identity of the dmabuf behind the first memory of @buffer */
+static gboolean
+gst_aml_v4l2_buffer_pool_dmabuf_identity(GstBuffer *buffer, guint64 *dev, guint64 *ino)
+{
+    GstMemory *mem;
+    struct stat st;
+
+    if (gst_buffer_n_memory(buffer) == 0)
+        return FALSE;
+
+    mem = gst_buffer_peek_memory(buffer, 0);
+    if (!gst_is_dmabuf_memory(mem) || fstat(gst_dmabuf_memory_get_fd(mem), &st) < 0)
+        return FALSE;
+
+    *dev = st.st_dev;
+    *ino = st.st_ino;
+    return TRUE;
+}
+
+static gint
+gst_aml_v4l2_buffer_pool_import_lookup(GstAmlV4l2BufferPool *pool, guint64 dev, guint64 ino)
+{
+    gint i;
+
+    for (i = 0; i < VIDEO_MAX_FRAME; i++)
+    {
+        if (pool->import_ino[i] == ino && pool->import_dev[i] == dev)
+            return i;
+    }
+    return -1;
+}
+
+/* Binds the dmabuf @dev/@ino to @index, dropping the index it was bound to
+ * before so that a rebound dmabuf does not hold two */
+static void
+gst_aml_v4l2_buffer_pool_import_bind(GstAmlV4l2BufferPool *pool, gint index, guint64 dev, guint64 ino)
+{
+    gint old;
+
+    if (ino != 0)
+    {
+        while ((old = gst_aml_v4l2_buffer_pool_import_lookup(pool, dev, ino)) >= 0 && old != index)
+        {
+            pool->import_dev[old] = 0;
+            pool->import_ino[old] = 0;
+        }
+    }
+
+    pool->import_dev[index] = dev;
+    pool->import_ino[index] = ino;
+}
+
+/* Acquires a free OUTPUT buffer for importing @src. A recurring dmabuf gets
+ * the index it was imported at last time: vb2 then finds the same dma_buf on
+ * that index at QBUF and keeps its attachment and mapping instead of
+ * re-attaching. Falls back to any free buffer. */
+static GstFlowReturn
+gst_aml_v4l2_buffer_pool_acquire_import(GstAmlV4l2BufferPool *pool, GstBuffer *src,
+                                        GstBuffer **buffer, GstBufferPoolAcquireParams *params)
+{
+    GstBufferPool *bpool = GST_BUFFER_POOL(pool);
+    GstBuffer *skipped[VIDEO_MAX_FRAME];
+    GstAmlV4l2MemoryGroup *group;
+    GstFlowReturn ret;
+    guint64 dev, ino;
+    gint n_skipped = 0;
+    gint index;
+    gint i;
+
+    if (pool->obj->mode != GST_V4L2_IO_DMABUF_IMPORT ||
+        !gst_aml_v4l2_buffer_pool_dmabuf_identity(src, &dev, &ino))
+        return gst_buffer_pool_acquire_buffer(bpool, buffer, params);
+
+    index = gst_aml_v4l2_buffer_pool_import_lookup(pool, dev, ino);
+
+    ret = gst_buffer_pool_acquire_buffer(bpool, buffer, params);
+
+    /* the free list is short, look through it for the bound index unless
+     * that one is still queued */
+    if (index >= 0 && pool->buffers[index] == NULL)
+    {
+        GstBufferPoolAcquireParams dontwait = {0};
+
+        dontwait.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+        while (ret == GST_FLOW_OK && gst_aml_v4l2_is_buffer_valid(*buffer, &group) &&
+               group->buffer.index != index && n_skipped < G_N_ELEMENTS(skipped))
+        {
+            skipped[n_skipped++] = *buffer;
+            ret = gst_buffer_pool_acquire_buffer(bpool, buffer, &dontwait);
+        }
+
+        if (ret != GST_FLOW_OK && n_skipped > 0)
+        {
+            /* not free after all, take the first one */
+            *buffer = skipped[0];
+            skipped[0] = NULL;
+            ret = GST_FLOW_OK;
+        }
+    }
+
+    for (i = 0; i < n_skipped; i++)
+    {
+        if (skipped[i])
+            gst_buffer_unref(skipped[i]);
+    }
+
+    if (ret == GST_FLOW_OK && gst_aml_v4l2_is_buffer_valid(*buffer, &group))
+    {
+        i = group->buffer.index;
+        if (i == index)
+            GST_LOG_OBJECT(pool, "dmabuf %" G_GUINT64_FORMAT " back at index %d", ino, i);
+        gst_aml_v4l2_buffer_pool_import_bind(pool, i, dev, ino);
+    }
+
+    return ret;
+}
+
 static GstFlowReturn
 gst_aml_v4l2_buffer_pool_prepare_buffer(GstAmlV4l2BufferPool *pool,
                                         GstBuffer *dest, GstBuffer *src)
@@ -672,6 +917,69 @@ gst_aml_v4l2_buffer_pool_resurrect_buffer(GstAmlV4l2BufferPool *pool)
     return ret;
 }
 
+/* Elastic capture pool: the fewest buffers left queued over a window of
+ * frames is what the driver never needed, give that back minus one spare so
+ * that growing again stays the exception. */
+static void
+gst_aml_v4l2_buffer_pool_update_watermark(GstAmlV4l2BufferPool *pool, guint num_queued)
+{
+    guint count = pool->vallocator->count;
+    guint spare;
+
+    /* we ran dry, whatever was planned is wrong now */
+    if (num_queued == 0)
+        g_atomic_int_set(&pool->shrink_pending, 0);
+
+    pool->low_watermark = MIN(pool->low_watermark, num_queued);
+    if (++pool->watermark_frames < GST_AML_V4L2_ELASTIC_WINDOW)
+        return;
+
+    spare = pool->low_watermark > 1 ? pool->low_watermark - 1 : 0;
+    if (count < pool->elastic_min + spare)
+        spare = count > pool->elastic_min ? count - pool->elastic_min : 0;
+
+    if (spare > 0 && GST_AML_V4L2_ALLOCATOR_CAN_REMOVE_BUFS(pool->vallocator))
+    {
+        GST_DEBUG_OBJECT(pool, "at least %u buffers stayed queued over %u frames, "
+                               "giving back %u of %u",
+                         pool->low_watermark, pool->watermark_frames, spare, count);
+        g_atomic_int_set(&pool->shrink_pending, spare);
+    }
+
+    pool->low_watermark = G_MAXUINT;
+    pool->watermark_frames = 0;
+}
+
+/* Called instead of queuing back the buffer with the highest index */
+static void
+gst_aml_v4l2_buffer_pool_shrink(GstAmlV4l2BufferPool *pool, GstBuffer *buffer)
+{
+    GstBufferPoolClass *pclass = GST_BUFFER_POOL_CLASS(parent_class);
+    GstAmlV4l2Return ret;
+
+    /* free it without letting the allocator hand the group back to us */
+    g_signal_handler_block(pool->vallocator, pool->group_released_handler);
+    GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_TAG_MEMORY);
+    pclass->release_buffer(GST_BUFFER_POOL(pool), buffer);
+    ret = gst_aml_v4l2_allocator_remove_last(pool->vallocator);
+    g_signal_handler_unblock(pool->vallocator, pool->group_released_handler);
+
+    switch (ret)
+    {
+    case GST_V4L2_OK:
+        g_atomic_int_add(&pool->shrink_pending, -1);
+        pool->num_allocated = pool->vallocator->count;
+        break;
+    case GST_V4L2_BUSY:
+        /* memory still shared downstream, group-released will resurrect it */
+        break;
+    default:
+        g_atomic_int_set(&pool->shrink_pending, 0);
+        gst_aml_v4l2_buffer_pool_resurrect_buffer(pool);
+        break;
+    }
+}
+
 static gboolean
 gst_aml_v4l2_buffer_pool_streamon(GstAmlV4l2BufferPool *pool)
 {
@@ -822,9 +1130,15 @@ gst_aml_v4l2_buffer_pool_start(GstBufferPool *bpool)
     guint size, min_buffers, max_buffers;
     guint max_latency, min_latency, copy_threshold = 0;
     gboolean can_allocate = FALSE, ret = TRUE;
+    gint i;
 
     GST_DEBUG_OBJECT(pool, "activating pool");
 
+    memset(pool->import_dev, 0, sizeof(pool->import_dev));
+    memset(pool->import_ino, 0, sizeof(pool->import_ino));
+    for (i = 0; i < VIDEO_MAX_FRAME; i++)
+        pool->userptr_data[i].layout_valid = FALSE;
+
     if (pool->other_pool)
     {
         GstBuffer *buffer;
@@ -872,6 +1186,11 @@ gst_aml_v4l2_buffer_pool_start(GstBufferPool *bpool)
 
         can_allocate = GST_AML_V4L2_ALLOCATOR_CAN_ALLOCATE(pool->vallocator, MMAP);
 
+        /* only capture buffers that are never mapped can skip cache maintenance */
+        gst_aml_v4l2_allocator_set_cpu_access(pool->vallocator,
+                                              V4L2_TYPE_IS_OUTPUT(obj->type) || pool->cpu_access ||
+                                                  pool->enable_copy_threshold || obj->dumpframefile);
+
         /* first, lets request buffers, and see how many we can get: */
         GST_DEBUG_OBJECT(pool, "requesting %d MMAP buffers", min_buffers);
 
@@ -896,6 +1215,7 @@ gst_aml_v4l2_buffer_pool_start(GstBufferPool *bpool)
                                "Uncertain or not enough buffers, enabling copy threshold");
             min_buffers = count;
             copy_threshold = min_latency;
+            gst_aml_v4l2_allocator_set_cpu_access(pool->vallocator, TRUE);
         }
 
         break;
@@ -960,6 +1280,33 @@ gst_aml_v4l2_buffer_pool_start(GstBufferPool *bpool)
     pool->max_latency = max_latency;
     pool->min_latency = min_latency;
     pool->num_queued = 0;
+    pool->elastic_min = min_buffers;
+    pool->low_watermark = G_MAXUINT;
+    pool->watermark_frames = 0;
+    pool->shrink_pending = 0;
+
+    if (obj->elastic_pool && !V4L2_TYPE_IS_OUTPUT(obj->type))
+    {
+        /* both only apply to buffers the driver allocates, shrinking needs
+         * V4L2_BUF_CAP_SUPPORTS_REMOVE_BUFS, Linux 6.10 and later */
+        gboolean own_buffers = (obj->mode == GST_V4L2_IO_MMAP || obj->mode == GST_V4L2_IO_DMABUF);
+        gboolean can_grow = own_buffers && GST_AML_V4L2_ALLOCATOR_CAN_ALLOCATE(pool->vallocator, MMAP);
+        gboolean can_shrink = own_buffers && GST_AML_V4L2_ALLOCATOR_CAN_REMOVE_BUFS(pool->vallocator);
+
+        if (!can_grow && !can_shrink)
+            GST_WARNING_OBJECT(pool, "elastic pool requested, but %s, the pool keeps %u buffers",
+                               own_buffers ? "the driver supports neither CREATE_BUFS nor REMOVE_BUFS"
+                                           : "the buffers are imported",
+                               min_buffers);
+        else if (!can_grow)
+            GST_WARNING_OBJECT(pool, "elastic pool requested, but the driver can't CREATE_BUFS, "
+                                     "the pool keeps %u buffers",
+                               min_buffers);
+        else
+            GST_INFO_OBJECT(pool, "elastic pool, %u buffers growing up to %u%s",
+                            min_buffers, max_buffers,
+                            can_shrink ? "" : ", no REMOVE_BUFS, shrinking on restart only");
+    }
 
     if (max_buffers != 0 && max_buffers < min_buffers)
         max_buffers = min_buffers;
@@ -1077,6 +1424,14 @@ gst_aml_v4l2_buffer_pool_stop(GstBufferPool *bpool)
         pool->other_pool = NULL;
     }
 
+    /* copies still downstream keep the staging pool alive until they return */
+    if (pool->staging_pool)
+    {
+        gst_buffer_pool_set_active(pool->staging_pool, FALSE);
+        gst_object_unref(pool->staging_pool);
+        pool->staging_pool = NULL;
+    }
+
     return ret;
 }
 
@@ -1086,7 +1441,7 @@ gst_aml_v4l2_buffer_pool_orphan(GstBufferPool **bpool)
     GstAmlV4l2BufferPool *pool = GST_AML_V4L2_BUFFER_POOL(*bpool);
     gboolean ret;
 
-    if (!GST_AML_V4L2_ALLOCATOR_CAN_ORPHAN_BUFS(pool->vallocator))
+    if (!gst_aml_v4l2_allocator_can_orphan(pool->vallocator))
         return FALSE;
 
     if (g_getenv("GST_V4L2_FORCE_DRAIN"))
@@ -1118,6 +1473,51 @@ orphan_failed:
     return ret;
 }
 
+typedef struct
+{
+    gint refs; /* the pool and its allocator */
+    GDestroyNotify notify;
+    gpointer data;
+} GstAmlV4l2BufferPoolFreeNotify;
+
+static void
+gst_aml_v4l2_buffer_pool_free_notify_unref(gpointer data)
+{
+    GstAmlV4l2BufferPoolFreeNotify *free_notify = data;
+
+    if (g_atomic_int_dec_and_test(&free_notify->refs))
+    {
+        free_notify->notify(free_notify->data);
+        g_free(free_notify);
+    }
+}
+
+/* @notify is called with @data once the pool and its allocator are both
+ * finalized, nothing uses the pool's object after that. An orphaned pool
+ * lives on until downstream returns its last buffer, this is how the
+ * object can be freed then. */
+void
+gst_aml_v4l2_buffer_pool_set_free_notify(GstAmlV4l2BufferPool *pool, GDestroyNotify notify,
+                                         gpointer data)
+{
+    GstAmlV4l2BufferPoolFreeNotify *free_notify;
+
+    g_return_if_fail(pool->free_notify == NULL);
+
+    free_notify = g_new0(GstAmlV4l2BufferPoolFreeNotify, 1);
+    free_notify->refs = 1;
+    free_notify->notify = notify;
+    free_notify->data = data;
+
+    if (pool->vallocator)
+    {
+        free_notify->refs++;
+        gst_aml_v4l2_allocator_set_free_notify(pool->vallocator,
+                                               gst_aml_v4l2_buffer_pool_free_notify_unref, free_notify);
+    }
+    pool->free_notify = free_notify;
+}
+
 static void
 gst_aml_v4l2_buffer_pool_flush_start(GstBufferPool *bpool)
 {
@@ -1149,6 +1549,30 @@ gst_aml_v4l2_buffer_pool_flush_stop(GstBufferPool *bpool)
     gst_poll_set_flushing(pool->poll, FALSE);
 }
 
+/* Called on every capture qbuf and dqbuf: only copies counters, the ring is
+ * formatted when queried or dumped */
+static void
+gst_aml_v4l2_buffer_pool_record_stat(GstAmlV4l2BufferPool *pool, gint try_num)
+{
+    GstAmlV4l2BufferPoolStat *stat;
+    GstBufferPool *other_pool = pool->other_pool;
+    gint other_outstanding = other_pool ? gst_buffer_pool_get_outstanding_num(other_pool) : -1;
+
+    GST_OBJECT_LOCK(pool);
+    stat = &pool->stats[pool->stats_recorded++ % GST_AML_V4L2_BUFFER_POOL_STATS];
+    stat->time = g_get_monotonic_time() * GST_USECOND;
+    stat->queued = g_atomic_int_get(&pool->num_queued);
+    stat->allocated = pool->num_allocated;
+#ifdef GST_AML_SPEC_FLOW_FOR_VBP
+    stat->ready_to_free = pool->ready_to_free_buf_num;
+#else
+    stat->ready_to_free = 0;
+#endif
+    stat->other_outstanding = other_outstanding;
+    stat->try_num = try_num;
+    GST_OBJECT_UNLOCK(pool);
+}
+
 static GstFlowReturn
 gst_aml_v4l2_buffer_pool_poll(GstAmlV4l2BufferPool *pool, gboolean wait)
 {
@@ -1250,7 +1674,7 @@ wait_buffer_queue:
             pool->obj->mode == GST_V4L2_IO_DMABUF_IMPORT)
         {
             GST_TRACE_OBJECT(pool, "amlmodbuf can't get buffer in capture obj dmaimport mode, try release buf from other pool");
-            gst_aml_v4l2_buffer_pool_dump_stat(pool, GST_DUMP_CAPTURE_BP_STAT_FILENAME, try_num++);
+            gst_aml_v4l2_buffer_pool_record_stat(pool, ++try_num);
             gst_aml_v4l2_buffer_pool_release_buffer_aml_patch((GstBufferPool *)pool);
             goto again;
         }
@@ -1335,15 +1759,13 @@ gst_aml_v4l2_buffer_pool_qbuf(GstAmlV4l2BufferPool *pool, GstBuffer *buf,
     if (!gst_aml_v4l2_allocator_qbuf(pool->vallocator, group))
         goto queue_failed;
 
-    if (!V4L2_TYPE_IS_OUTPUT(obj->type))
-    {
-        gst_aml_v4l2_buffer_pool_dump_stat(pool, GST_DUMP_CAPTURE_BP_STAT_FILENAME, 0);
-    }
-
     pool->empty = FALSE;
     g_cond_signal(&pool->empty_cond);
     GST_OBJECT_UNLOCK(pool);
 
+    if (!V4L2_TYPE_IS_OUTPUT(obj->type))
+        gst_aml_v4l2_buffer_pool_record_stat(pool, 0);
+
     return GST_FLOW_OK;
 
 already_queued:
@@ -1363,40 +1785,6 @@ queue_failed:
 }
 }
 
-static GstFlowReturn
-gst_aml_v4l2_buffer_pool_dqevent(GstAmlV4l2BufferPool *pool)
-{
-    GstAmlV4l2Object *v4l2object = pool->obj;
-    struct v4l2_event evt;
-
-    memset(&evt, 0x00, sizeof(struct v4l2_event));
-    if (v4l2object->ioctl(pool->video_fd, VIDIOC_DQEVENT, &evt) < 0)
-        goto dqevent_failed;
-
-    switch (evt.type)
-    {
-    case V4L2_EVENT_SOURCE_CHANGE:
-
-        if (evt.u.src_change.changes & V4L2_EVENT_SRC_CH_RESOLUTION)
-            return GST_AML_V4L2_FLOW_SOURCE_CHANGE;
-        GST_WARNING_OBJECT (pool, "Unknown source change 0x%x - skipped", evt.u.src_change.changes);
-        break;
-    case V4L2_EVENT_EOS:
-        return GST_AML_V4L2_FLOW_LAST_BUFFER;
-        break;
-    default:
-        break;
-    }
-
-    return GST_FLOW_OK;
-
-    /* ERRORS */
-dqevent_failed:
-{
-    return GST_FLOW_ERROR;
-}
-}
-
 static GstFlowReturn
 gst_aml_v4l2_buffer_pool_dqbuf(GstAmlV4l2BufferPool *pool, GstBuffer **buffer,
                                gboolean wait)
@@ -1554,9 +1942,7 @@ done:
     }
 
     if (!V4L2_TYPE_IS_OUTPUT(obj->type))
-    {
-        gst_aml_v4l2_buffer_pool_dump_stat(pool, GST_DUMP_CAPTURE_BP_STAT_FILENAME, 0);
-    }
+        gst_aml_v4l2_buffer_pool_record_stat(pool, 0);
 
     return res;
 
@@ -1587,22 +1973,22 @@ gst_aml_v4l2_buffer_pool_dequeue(GstAmlV4l2BufferPool *pool, GstBuffer **buffer,
     if ((res = gst_aml_v4l2_buffer_pool_poll(pool, wait)) != GST_FLOW_OK)
         goto poll_failed;
 
+    /* the same poll tells whether a buffer, events, or both are ready, take
+     * all the events at once */
     if (obj->can_wait_event && gst_poll_fd_can_read_pri(pool->poll, &pool->pollfd))
     {
-        GstFlowReturn res_event = gst_aml_v4l2_buffer_pool_dqevent(pool);
-        if (res_event != GST_FLOW_OK)
-        {
-            /* when drive V4l2 receive cmd_stop, it will finish current decoding frame, then creat
-             * a EOS event and a empty buff. if gstreamer dq EOS event first ,the last frame will be drop,
-             * this a question
-             */
-            if (res_event == GST_AML_V4L2_FLOW_LAST_BUFFER)
-            {
-                GST_DEBUG_OBJECT(pool," reiceive EOS event, drop it");
-            }
-            else
-                return res_event;
-        }
+        guint events = gst_aml_v4l2_object_drain_events(obj, pool->video_fd);
+
+        if (events & GST_AML_V4L2_EVENT_SOURCE_CHANGE)
+            return GST_AML_V4L2_FLOW_SOURCE_CHANGE;
+        if (events & GST_AML_V4L2_EVENT_ERROR)
+            return GST_FLOW_ERROR;
+        /* when drive V4l2 receive cmd_stop, it will finish current decoding frame, then creat
+         * a EOS event and a empty buff. if gstreamer dq EOS event first ,the last frame will be drop,
+         * this a question
+         */
+        if (events & GST_AML_V4L2_EVENT_EOS)
+            GST_DEBUG_OBJECT(pool," reiceive EOS event, drop it");
     }
     if (res == GST_FLOW_CUSTOM_SUCCESS)
     {
@@ -1763,6 +2149,14 @@ gst_aml_v4l2_buffer_pool_release_buffer(GstBufferPool *bpool, GstBuffer *buffer)
 
                 gst_aml_v4l2_allocator_reset_group(pool->vallocator, group);
 
+                if (g_atomic_int_get(&pool->shrink_pending) > 0 &&
+                    (obj->mode == GST_V4L2_IO_MMAP || obj->mode == GST_V4L2_IO_DMABUF) &&
+                    group->buffer.index + 1 == pool->vallocator->count)
+                {
+                    gst_aml_v4l2_buffer_pool_shrink(pool, buffer);
+                    return;
+                }
+
 #ifdef GST_AML_SPEC_FLOW_FOR_VBP
                 GST_DEBUG_OBJECT(pool, "amlmodbuf trace in add flow with buf:%p index:%d", buffer, group->buffer.index);
                 pool->read_to_free_bufs[group->buffer.index] = buffer;
@@ -1861,6 +2255,51 @@ gst_aml_v4l2_buffer_pool_release_buffer(GstBufferPool *bpool, GstBuffer *buffer)
 }
 
 #ifdef GST_AML_SPEC_FLOW_FOR_VBP
+/* Picks a returned capture buf for @src and binds them, ignoring affinity */
+static gint
+gst_aml_v4l2_buffer_pool_capture_slot_any(GstAmlV4l2BufferPool *pool, GstBuffer *src)
+{
+    guint64 dev = 0, ino = 0;
+    gint i, slot = -1;
+
+    gst_aml_v4l2_buffer_pool_dmabuf_identity(src, &dev, &ino);
+
+    /* prefer a capture buf nothing is bound to yet */
+    for (i = 0; i < VIDEO_MAX_FRAME; i++)
+    {
+        if (!pool->read_to_free_bufs[i])
+            continue;
+        if (slot < 0 || pool->import_ino[i] == 0)
+            slot = i;
+        if (pool->import_ino[i] == 0)
+            break;
+    }
+
+    if (slot >= 0)
+        gst_aml_v4l2_buffer_pool_import_bind(pool, slot, dev, ino);
+    return slot;
+}
+
+/* Each drm buf of the other pool sticks to one capture index so that vb2
+ * keeps its dma-buf attachment. Returns the returned capture buf @src goes
+ * to, or -1 when the one it is bound to is still queued or downstream. */
+static gint
+gst_aml_v4l2_buffer_pool_capture_slot(GstAmlV4l2BufferPool *pool, GstBuffer *src)
+{
+    guint64 dev, ino;
+    gint i;
+
+    if (!gst_aml_v4l2_buffer_pool_dmabuf_identity(src, &dev, &ino))
+        return gst_aml_v4l2_buffer_pool_capture_slot_any(pool, src);
+
+    i = gst_aml_v4l2_buffer_pool_import_lookup(pool, dev, ino);
+    if (i >= 0)
+        return pool->read_to_free_bufs[i] ? i : -1;
+
+    /* a drm buf we have not seen, e.g. at start or after the other pool grew */
+    return gst_aml_v4l2_buffer_pool_capture_slot_any(pool, src);
+}
+
 static gboolean
 gst_aml_v4l2_buffer_pool_release_buffer_aml_patch(GstBufferPool *bpool)
 {
@@ -1873,7 +2312,10 @@ gst_aml_v4l2_buffer_pool_release_buffer_aml_patch(GstBufferPool *bpool)
     if (obj->mode == GST_V4L2_IO_DMABUF_IMPORT && pool->other_pool)
     {
         GstBuffer *src = NULL;
+        GstBuffer *held[VIDEO_MAX_FRAME];
         GstBufferPoolAcquireParams params;
+        gint n_held = 0;
+        gint i;
 
         if (obj->old_other_pool || obj->old_old_other_pool)
         {
@@ -1908,52 +2350,56 @@ gst_aml_v4l2_buffer_pool_release_buffer_aml_patch(GstBufferPool *bpool)
         GST_TRACE_OBJECT(pool, "amlmodbuf trace in aml release buf flow ready_to_free_buf_num:%d", pool->ready_to_free_buf_num);
         while (pool->ready_to_free_buf_num && gst_buffer_pool_acquire_buffer(pool->other_pool, &src, &params) != GST_FLOW_ERROR && src != NULL)
         {
-            gint i = 0;
+            GstFlowReturn isvalid = GST_FLOW_OK;
+            GstAmlV4l2MemoryGroup *tmp_group = NULL;
 
             GST_TRACE_OBJECT(pool, "amlmodbuf acquire buf:%p form other pool", src);
-            for (; i < VIDEO_MAX_FRAME; i++)
-            {
-                GST_DEBUG_OBJECT(pool, "amlmodbuf check index:%d", i);
-                if (pool->read_to_free_bufs[i])
-                {
-                    GstBuffer *bind_drm_buf = gst_mini_object_get_qdata(GST_MINI_OBJECT(pool->read_to_free_bufs[i]), GST_AML_V4L2_IMPORT_QUARK);
-                    if (bind_drm_buf == NULL)
-                    {
-                        GST_TRACE_OBJECT(pool, "init flow, bind v4l2 capture buf[%d]:%p with drm buf:%p", i, pool->read_to_free_bufs[i], src);
-                    }
-                    else if (src != bind_drm_buf)
-                    {
-                        GST_TRACE_OBJECT(pool, "v4l2 capture buf[%d]:%p bind drm buf:%p, not this one:%p, continue match", i, pool->read_to_free_bufs[i], bind_drm_buf, src);
-                        continue;
-                    }
-
-                    GST_TRACE_OBJECT(pool, "v4l2 capture buf[%d]:%p found bind drm buf:%p", i, pool->read_to_free_bufs[i], src);
-                    GstFlowReturn isvalid = GST_FLOW_OK;
-                    GstAmlV4l2MemoryGroup *tmp_group = NULL;
 
-                    // bind_drm_buf= gst_mini_object_steal_qdata(GST_MINI_OBJECT(pool->read_to_free_bufs[i]), GST_AML_V4L2_IMPORT_QUARK);
-                    ret = gst_aml_v4l2_buffer_pool_import_dmabuf(pool, pool->read_to_free_bufs[i], src);
-                    gst_buffer_unref(src);
-                    src = NULL;
-                    isvalid = gst_aml_v4l2_is_buffer_valid(pool->read_to_free_bufs[i], &tmp_group);
-                    if ((ret != GST_FLOW_OK && isvalid) || gst_aml_v4l2_buffer_pool_qbuf(pool, pool->read_to_free_bufs[i], tmp_group) != GST_FLOW_OK)
-                    {
-                        GST_TRACE_OBJECT(pool, "amlmodbuf go into error flow");
-                        pclass->release_buffer(bpool, pool->read_to_free_bufs[i]);
-                    }
-                    pool->read_to_free_bufs[i] = NULL;
-                    pool->ready_to_free_buf_num--;
-                    GST_TRACE_OBJECT(pool, "amlmodbuf queued buf:%d, into v4l2 bp", i);
+            i = gst_aml_v4l2_buffer_pool_capture_slot(pool, src);
+            if (i < 0)
+            {
+                /* its capture buf is still busy, wait for it */
+                held[n_held++] = src;
+                src = NULL;
+                if (n_held == G_N_ELEMENTS(held))
                     break;
-                }
+                continue;
             }
-            if (i == VIDEO_MAX_FRAME)
+
+            GST_TRACE_OBJECT(pool, "v4l2 capture buf[%d]:%p takes drm buf:%p", i, pool->read_to_free_bufs[i], src);
+            ret = gst_aml_v4l2_buffer_pool_import_dmabuf(pool, pool->read_to_free_bufs[i], src);
+            gst_buffer_unref(src);
+            src = NULL;
+            isvalid = gst_aml_v4l2_is_buffer_valid(pool->read_to_free_bufs[i], &tmp_group);
+            if ((ret != GST_FLOW_OK && isvalid) || gst_aml_v4l2_buffer_pool_qbuf(pool, pool->read_to_free_bufs[i], tmp_group) != GST_FLOW_OK)
             {
-                GST_ERROR_OBJECT(pool, "drm buf:%p can't match any v4l2 capture buf, error", src);
-                gst_buffer_unref(src);
-                src = NULL;
-                return FALSE;
+                GST_TRACE_OBJECT(pool, "amlmodbuf go into error flow");
+                pclass->release_buffer(bpool, pool->read_to_free_bufs[i]);
             }
+            pool->read_to_free_bufs[i] = NULL;
+            pool->ready_to_free_buf_num--;
+            GST_TRACE_OBJECT(pool, "amlmodbuf queued buf:%d, into v4l2 bp", i);
+        }
+
+        /* with fewer capture bufs queued than the decoder needs it would
+         * starve waiting for the bound drm bufs, rebind the held ones instead */
+        for (i = 0; i < n_held; i++)
+        {
+            if (pool->ready_to_free_buf_num && g_atomic_int_get(&pool->num_queued) < obj->min_buffers)
+            {
+                GstAmlV4l2MemoryGroup *tmp_group = NULL;
+                gint j = gst_aml_v4l2_buffer_pool_capture_slot_any(pool, held[i]);
+
+                GST_DEBUG_OBJECT(pool, "%d capture bufs queued, rebind drm buf:%p to buf[%d]",
+                                 g_atomic_int_get(&pool->num_queued), held[i], j);
+                ret = gst_aml_v4l2_buffer_pool_import_dmabuf(pool, pool->read_to_free_bufs[j], held[i]);
+                if (!gst_aml_v4l2_is_buffer_valid(pool->read_to_free_bufs[j], &tmp_group) || ret != GST_FLOW_OK ||
+                    gst_aml_v4l2_buffer_pool_qbuf(pool, pool->read_to_free_bufs[j], tmp_group) != GST_FLOW_OK)
+                    pclass->release_buffer(bpool, pool->read_to_free_bufs[j]);
+                pool->read_to_free_bufs[j] = NULL;
+                pool->ready_to_free_buf_num--;
+            }
+            gst_buffer_unref(held[i]);
         }
         GST_TRACE_OBJECT(pool, "update all free drm buf into v4l2 capture buf pool, now ready_to_free_buf_num:%d", pool->ready_to_free_buf_num);
         return TRUE;
@@ -1998,6 +2444,16 @@ gst_aml_v4l2_buffer_pool_finalize(GObject *object)
     gst_object_unref(pool->obj->element);
 
     g_cond_clear(&pool->empty_cond);
+    g_free(pool->userptr_data);
+
+    if (pool->staging_pool)
+    {
+        gst_buffer_pool_set_active(pool->staging_pool, FALSE);
+        gst_object_unref(pool->staging_pool);
+    }
+
+    if (pool->free_notify)
+        gst_aml_v4l2_buffer_pool_free_notify_unref(pool->free_notify);
 
     /* FIXME have we done enough here ? */
 
@@ -2014,6 +2470,7 @@ gst_aml_v4l2_buffer_pool_init(GstAmlV4l2BufferPool *pool)
     pool->empty = TRUE;
     GST_OBJECT_UNLOCK(pool);
     pool->orphaned = FALSE;
+    pool->userptr_data = g_new0(struct UserPtrData, VIDEO_MAX_FRAME);
 }
 
 static void
@@ -2086,6 +2543,7 @@ gst_aml_v4l2_buffer_pool_new(GstAmlV4l2Object *obj, GstCaps *caps)
     pool->video_fd = fd;
     pool->obj = obj;
     pool->can_poll_device = TRUE;
+    pool->cpu_access = TRUE;
 
     pool->vallocator = gst_aml_v4l2_allocator_new(GST_OBJECT(pool), obj);
     if (pool->vallocator == NULL)
@@ -2244,12 +2702,16 @@ gst_aml_v4l2_buffer_pool_process(GstAmlV4l2BufferPool *pool, GstBuffer **buf)
                 GST_TRACE_OBJECT(pool, "Only %i buffer left in the capture queue.",
                                  num_queued);
 
+                if (obj->elastic_pool)
+                    gst_aml_v4l2_buffer_pool_update_watermark(pool, num_queued);
+
                 /* If we have no more buffer, and can allocate it time to do so */
                 if (num_queued == 0)
                 {
                     if (GST_AML_V4L2_ALLOCATOR_CAN_ALLOCATE(pool->vallocator, MMAP))
                     {
                         ret = gst_aml_v4l2_buffer_pool_resurrect_buffer(pool);
+                        pool->num_allocated = pool->vallocator->count;
                         if (ret == GST_FLOW_OK)
                             goto done;
                     }
@@ -2268,8 +2730,10 @@ gst_aml_v4l2_buffer_pool_process(GstAmlV4l2BufferPool *pool, GstBuffer **buf)
                     }
 
                     /* copy the buffer */
-                    copy = gst_buffer_copy_region(*buf,
-                                                  GST_BUFFER_COPY_ALL | GST_BUFFER_COPY_DEEP, 0, -1);
+                    copy = gst_aml_v4l2_buffer_pool_copy_to_staging(pool, *buf);
+                    if (!copy)
+                        copy = gst_buffer_copy_region(*buf,
+                                                      GST_BUFFER_COPY_ALL | GST_BUFFER_COPY_DEEP, 0, -1);
                     GST_LOG_OBJECT(pool, "copy buffer %p->%p", *buf, copy);
 
                     /* and requeue so that we can continue capturing */
@@ -2428,7 +2892,18 @@ gst_aml_v4l2_buffer_pool_process(GstAmlV4l2BufferPool *pool, GstBuffer **buf)
                  * be strange because we would expect the upstream element to have
                  * allocated them and returned to us.. */
                 params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
-                ret = gst_buffer_pool_acquire_buffer(bpool, &to_queue, &params);
+                ret = gst_aml_v4l2_buffer_pool_acquire_import(pool, *buf, &to_queue, &params);
+                if (ret == GST_FLOW_EOS && obj->low_latency_mode)
+                {
+                    /* in low latency mode we don't wait for the decoder after
+                     * queuing, so reclaim a rendered buffer only now that the
+                     * pool has run dry */
+                    ret = gst_aml_v4l2_buffer_pool_dequeue(pool, &buffer, TRUE);
+                    if (ret == GST_FLOW_OK && buffer->pool == NULL)
+                        gst_aml_v4l2_buffer_pool_release_buffer(bpool, buffer);
+                    if (ret == GST_FLOW_OK)
+                        ret = gst_aml_v4l2_buffer_pool_acquire_import(pool, *buf, &to_queue, &params);
+                }
                 if (ret != GST_FLOW_OK)
                     goto acquire_failed;
 
@@ -2480,7 +2955,8 @@ gst_aml_v4l2_buffer_pool_process(GstAmlV4l2BufferPool *pool, GstBuffer **buf)
                     gst_aml_v4l2_buffer_pool_release_buffer(bpool, buffer);
             }
 
-            if (g_atomic_int_get(&pool->num_queued) >= pool->min_latency)
+            if (!obj->low_latency_mode &&
+                g_atomic_int_get(&pool->num_queued) >= pool->min_latency)
             {
                 /* all buffers are queued, try to dequeue one and release it back
                  * into the pool so that _acquire can get to it again. */
@@ -2568,6 +3044,13 @@ void gst_aml_v4l2_buffer_pool_copy_at_threshold(GstAmlV4l2BufferPool *pool, gboo
     GST_OBJECT_UNLOCK(pool);
 }
 
+void gst_aml_v4l2_buffer_pool_set_cpu_access(GstAmlV4l2BufferPool *pool, gboolean cpu_access)
+{
+    GST_OBJECT_LOCK(pool);
+    pool->cpu_access = cpu_access;
+    GST_OBJECT_UNLOCK(pool);
+}
+
 gboolean
 gst_aml_v4l2_buffer_pool_flush(GstBufferPool *bpool)
 {
@@ -2582,89 +3065,154 @@ gst_aml_v4l2_buffer_pool_flush(GstBufferPool *bpool)
     return ret;
 }
 
-void gst_aml_v4l2_buffer_pool_dump_stat(GstAmlV4l2BufferPool *pool, const gchar *file_name, gint try_num)
+/* copies the ring out, oldest snapshot at stats[recorded % size], and
+ * returns the number of snapshots ever recorded */
+static guint64
+gst_aml_v4l2_buffer_pool_copy_stats(GstAmlV4l2BufferPool *pool, GstAmlV4l2BufferPoolStat *stats,
+                                    GstBufferPool **other_pool)
+{
+    guint64 recorded;
+
+    GST_OBJECT_LOCK(pool);
+    recorded = pool->stats_recorded;
+    memcpy(stats, pool->stats, sizeof(pool->stats));
+    *other_pool = pool->other_pool ? gst_object_ref(pool->other_pool) : NULL;
+    GST_OBJECT_UNLOCK(pool);
+
+    return recorded;
+}
+
+static void
+gst_aml_v4l2_buffer_pool_config_params(GstBufferPool *pool, guint *size, guint *min_buffers,
+                                       guint *max_buffers)
+{
+    GstStructure *config = gst_buffer_pool_get_config(pool);
+
+    *size = *min_buffers = *max_buffers = 0;
+    if (config)
+    {
+        gst_buffer_pool_config_get_params(config, NULL, size, min_buffers, max_buffers);
+        gst_structure_free(config);
+    }
+    else
+    {
+        GST_WARNING("Failed to get config for pool:%p", pool);
+    }
+}
+
+/* The pool configs and the recorded snapshots, oldest first */
+GstStructure *
+gst_aml_v4l2_buffer_pool_get_stat(GstAmlV4l2BufferPool *pool)
+{
+    GstAmlV4l2BufferPoolStat stats[GST_AML_V4L2_BUFFER_POOL_STATS];
+    GstBufferPool *other_pool;
+    GstStructure *s;
+    GValue snapshots = G_VALUE_INIT;
+    GValue item = G_VALUE_INIT;
+    guint size, min_buffers, max_buffers;
+    guint64 recorded, i;
+
+    recorded = gst_aml_v4l2_buffer_pool_copy_stats(pool, stats, &other_pool);
+
+    gst_aml_v4l2_buffer_pool_config_params(GST_BUFFER_POOL(pool), &size, &min_buffers, &max_buffers);
+    s = gst_structure_new("aml-v4l2-pool-stat",
+                          "size", G_TYPE_UINT, size,
+                          "min-buffers", G_TYPE_UINT, min_buffers,
+                          "max-buffers", G_TYPE_UINT, max_buffers,
+                          "recorded", G_TYPE_UINT64, recorded,
+                          NULL);
+
+    if (other_pool)
+    {
+        gst_aml_v4l2_buffer_pool_config_params(other_pool, &size, &min_buffers, &max_buffers);
+        gst_structure_set(s,
+                          "other-size", G_TYPE_UINT, size,
+                          "other-min-buffers", G_TYPE_UINT, min_buffers,
+                          "other-max-buffers", G_TYPE_UINT, max_buffers,
+                          NULL);
+        gst_object_unref(other_pool);
+    }
+
+    g_value_init(&snapshots, GST_TYPE_ARRAY);
+    for (i = recorded - MIN(recorded, GST_AML_V4L2_BUFFER_POOL_STATS); i < recorded; i++)
+    {
+        GstAmlV4l2BufferPoolStat *stat = &stats[i % GST_AML_V4L2_BUFFER_POOL_STATS];
+
+        g_value_init(&item, GST_TYPE_STRUCTURE);
+        g_value_take_boxed(&item, gst_structure_new("snapshot",
+                                                    "time", G_TYPE_UINT64, stat->time,
+                                                    "queued", G_TYPE_UINT, stat->queued,
+                                                    "allocated", G_TYPE_UINT, stat->allocated,
+                                                    "ready-to-free", G_TYPE_INT, stat->ready_to_free,
+                                                    "other-outstanding", G_TYPE_INT, stat->other_outstanding,
+                                                    "try-num", G_TYPE_INT, stat->try_num,
+                                                    NULL));
+        gst_value_array_append_value(&snapshots, &item);
+        g_value_unset(&item);
+    }
+    gst_structure_take_value(s, "snapshots", &snapshots);
+
+    return s;
+}
+
+/* Writes the pool configs and the snapshot ring to
+ * $GST_DEBUG_DUMP_AMLV4L2DEC_STAT_DIR, FALSE when unset or on error */
+gboolean
+gst_aml_v4l2_buffer_pool_dump_stat(GstAmlV4l2BufferPool *pool)
 {
+    GstAmlV4l2BufferPoolStat stats[GST_AML_V4L2_BUFFER_POOL_STATS];
+    GstBufferPool *other_pool;
     const gchar *dump_dir = NULL;
+    const gchar *file_name;
     gchar *full_file_name = NULL;
+    guint size, min_buffers, max_buffers;
+    guint64 recorded, i;
     FILE *out = NULL;
 
     dump_dir = g_getenv("GST_DEBUG_DUMP_AMLV4L2DEC_STAT_DIR");
-    if (G_LIKELY(dump_dir == NULL))
-        return;
-
-    if (!file_name)
+    if (dump_dir == NULL)
     {
-        file_name = "unnamed";
+        GST_DEBUG_OBJECT(pool, "GST_DEBUG_DUMP_AMLV4L2DEC_STAT_DIR not set, not dumping");
+        return FALSE;
     }
 
+    file_name = V4L2_TYPE_IS_OUTPUT(pool->obj->type) ? GST_DUMP_OUTPUT_BP_STAT_FILENAME
+                                                     : GST_DUMP_CAPTURE_BP_STAT_FILENAME;
     full_file_name = g_strdup_printf("%s" G_DIR_SEPARATOR_S "%s.stat", dump_dir, file_name);
 
-    if ((out = fopen(full_file_name, "w")))
+    if (!(out = fopen(full_file_name, "w")))
     {
-        GstStructure *config = NULL;
-        config = gst_buffer_pool_get_config((GstBufferPool *)pool);
-        if (config)
-        {
-            GstCaps *caps;
-            guint size, min_buffers, max_buffers;
-            if (gst_buffer_pool_config_get_params(config, &caps, &size, &min_buffers, &max_buffers))
-            {
-                gchar *stat_info;
-
-                /* set local pool info*/
-                gint already_queued = 0;
-                gint ready_to_queue_num = 0;
-                for (gint i = 0; i < VIDEO_MAX_FRAME; i++)
-                {
-                    if (pool->buffers[i])
-                    {
-                        already_queued++;
-                    }
-                    if (pool->read_to_free_bufs[i])
-                    {
-                        ready_to_queue_num++;
-                    }
-                }
+        GST_WARNING("Failed to open file '%s' for writing: %s", full_file_name, g_strerror(errno));
+        g_free(full_file_name);
+        return FALSE;
+    }
 
-                stat_info = g_strdup_printf("local pool | size:%d,  min_bufs:%d, max_bufs:%d | queued:%d, allocated:%d | already_queued:%d, ready_to_queue:%d | try_num:%d\n",
-                                            size, min_buffers, max_buffers,
-                                            pool->num_queued, pool->num_allocated,
-                                            already_queued, ready_to_queue_num, try_num);
-                fputs(stat_info, out);
-                g_free(stat_info);
+    recorded = gst_aml_v4l2_buffer_pool_copy_stats(pool, stats, &other_pool);
 
-                /* set other pool info*/
-                if (pool->other_pool)
-                {
-                    GstStructure *other_config = NULL;
-                    other_config = gst_buffer_pool_get_config((GstBufferPool *)pool);
-                    if (other_config)
-                    {
-                        GstCaps *other_caps;
-                        guint other_size, other_min_buffers, other_max_buffers;
-                        if (gst_buffer_pool_config_get_params(config, &other_caps, &other_size, &other_min_buffers, &other_max_buffers))
-                        {
-                            stat_info = g_strdup_printf("other pool | size:%d,  min_bufs:%d, max_bufs:%d\n",
-                                                        other_size, other_min_buffers, other_max_buffers);
+    gst_aml_v4l2_buffer_pool_config_params(GST_BUFFER_POOL(pool), &size, &min_buffers, &max_buffers);
+    fprintf(out, "local pool | size:%u, min_bufs:%u, max_bufs:%u | recorded:%" G_GUINT64_FORMAT "\n",
+            size, min_buffers, max_buffers, recorded);
 
-                            // TODO:GstBufferPool中没有获取outstanding的接口，所以这里没有统计otherpool中在用buffer的状态，后续需要修改gstreamer-1.0中code新增接口
-                            fputs(stat_info, out);
-                            g_free(stat_info);
-                        }
-                    }
-                }
-                GST_INFO("wrote amlv4l2 bufferpool stat to : '%s' succ", full_file_name);
-            }
-        }
-        else
-        {
-            GST_WARNING("Failed to get config for pool:%p", pool);
-        }
-        fclose(out);
+    if (other_pool)
+    {
+        gst_aml_v4l2_buffer_pool_config_params(other_pool, &size, &min_buffers, &max_buffers);
+        fprintf(out, "other pool | size:%u, min_bufs:%u, max_bufs:%u\n",
+                size, min_buffers, max_buffers);
+        gst_object_unref(other_pool);
     }
-    else
+
+    for (i = recorded - MIN(recorded, GST_AML_V4L2_BUFFER_POOL_STATS); i < recorded; i++)
     {
-        GST_WARNING("Failed to open file '%s' for writing: %s", full_file_name, g_strerror(errno));
+        GstAmlV4l2BufferPoolStat *stat = &stats[i % GST_AML_V4L2_BUFFER_POOL_STATS];
+
+        fprintf(out, "%" GST_TIME_FORMAT " | queued:%u, allocated:%u | ready_to_queue:%d | other_outstanding:%d | try_num:%d\n",
+                GST_TIME_ARGS(stat->time), stat->queued, stat->allocated,
+                stat->ready_to_free, stat->other_outstanding, stat->try_num);
     }
+
+    fclose(out);
+    GST_INFO("wrote amlv4l2 bufferpool stat to : '%s' succ", full_file_name);
     g_free(full_file_name);
+
+    return TRUE;
 }
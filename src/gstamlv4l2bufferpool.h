@@ -52,6 +52,20 @@ G_BEGIN_DECLS
 
 #define GST_AML_SPEC_FLOW_FOR_VBP 1
 
+/* snapshots kept by each pool, the older ones are overwritten */
+#define GST_AML_V4L2_BUFFER_POOL_STATS 64
+
+/* pool state at one qbuf, dqbuf or poll timeout */
+typedef struct
+{
+    GstClockTime time; /* monotonic */
+    guint queued;
+    guint allocated;
+    gint ready_to_free;
+    gint other_outstanding; /* -1 without other pool */
+    gint try_num;           /* poll timeouts in a row */
+} GstAmlV4l2BufferPoolStat;
+
 struct _GstAmlV4l2BufferPool
 {
     GstBufferPool parent;
@@ -66,16 +80,19 @@ struct _GstAmlV4l2BufferPool
     GCond empty_cond;
 
     gboolean orphaned;
+    gpointer free_notify; /* see gst_aml_v4l2_buffer_pool_set_free_notify() */
 
     GstAmlV4l2Allocator *vallocator;
     GstAllocator *allocator;
     GstAllocationParams params;
     GstBufferPool *other_pool;
+    GstBufferPool *staging_pool; /* recycled copies handed out at copy_threshold */
     guint size;
     GstVideoInfo caps_info; /* Default video information */
 
     gboolean add_videometa;         /* set if video meta should be added */
     gboolean enable_copy_threshold; /* If copy_threshold should be set */
+    gboolean cpu_access;            /* downstream may map our buffers */
 
     guint min_latency;    /* number of buffers we will hold */
     guint max_latency;    /* number of buffers we can hold */
@@ -83,10 +100,24 @@ struct _GstAmlV4l2BufferPool
     guint num_allocated;  /* number of buffers allocated */
     guint copy_threshold; /* when our pool runs lower, start handing out copies */
 
+    /* elastic capture pool, see GstAmlV4l2Object:elastic_pool */
+    guint elastic_min;      /* never shrink below this */
+    guint low_watermark;    /* fewest buffers left queued in the current window */
+    guint watermark_frames; /* frames seen in the current window */
+    gint shrink_pending;    /* buffers to give back as they return */
+
     gboolean streaming;
     gboolean flushing;
 
     GstBuffer *buffers[VIDEO_MAX_FRAME];
+
+    /* identity (st_dev, st_ino) of the dmabuf last imported at each OUTPUT
+     * index, 0 when unbound */
+    guint64 import_dev[VIDEO_MAX_FRAME];
+    guint64 import_ino[VIDEO_MAX_FRAME];
+
+    /* USERPTR import state, one per index, with the layout last validated */
+    struct UserPtrData *userptr_data;
 #ifdef GST_AML_SPEC_FLOW_FOR_VBP
     GstBuffer *read_to_free_bufs[VIDEO_MAX_FRAME];
     gint ready_to_free_buf_num;
@@ -97,6 +128,10 @@ struct _GstAmlV4l2BufferPool
 
     /* Control to warn only once on buggy feild driver bug */
     gboolean has_warned_on_buggy_field;
+
+    /* state ring, under the object lock */
+    GstAmlV4l2BufferPoolStat stats[GST_AML_V4L2_BUFFER_POOL_STATS];
+    guint64 stats_recorded;
 };
 
 struct _GstAmlV4l2BufferPoolClass
@@ -114,12 +149,17 @@ void gst_aml_v4l2_buffer_pool_set_other_pool(GstAmlV4l2BufferPool *pool,
                                              GstBufferPool *other_pool);
 void gst_aml_v4l2_buffer_pool_copy_at_threshold(GstAmlV4l2BufferPool *pool,
                                                 gboolean copy);
+void gst_aml_v4l2_buffer_pool_set_cpu_access(GstAmlV4l2BufferPool *pool,
+                                             gboolean cpu_access);
 
 gboolean gst_aml_v4l2_buffer_pool_flush(GstBufferPool *pool);
 
 gboolean gst_aml_v4l2_buffer_pool_orphan(GstBufferPool **pool);
+void gst_aml_v4l2_buffer_pool_set_free_notify(GstAmlV4l2BufferPool *pool, GDestroyNotify notify,
+                                              gpointer data);
 
-void gst_aml_v4l2_buffer_pool_dump_stat(GstAmlV4l2BufferPool *pool, const gchar *file_name, gint try_num);
+GstStructure *gst_aml_v4l2_buffer_pool_get_stat(GstAmlV4l2BufferPool *pool);
+gboolean gst_aml_v4l2_buffer_pool_dump_stat(GstAmlV4l2BufferPool *pool);
 
 G_END_DECLS
 
@@ -529,6 +529,40 @@ gst_aml_v4l2_object_new(GstElement *element,
     return v4l2object;
 }
 
+/* An unopened object for a second context on the same device, carrying
+ * the user settings of @other but none of its runtime state */
+GstAmlV4l2Object *
+gst_aml_v4l2_object_new_like(GstAmlV4l2Object *other)
+{
+    GstAmlV4l2Object *v4l2object;
+
+    v4l2object = gst_aml_v4l2_object_new(other->element, other->dbg_obj, other->type,
+                                         other->videodev, other->get_in_out_func,
+                                         other->set_in_out_func, other->update_fps_func);
+
+    v4l2object->req_mode = other->req_mode;
+    v4l2object->keep_aspect = other->keep_aspect;
+    v4l2object->low_latency_mode = other->low_latency_mode;
+    v4l2object->stream_mode = other->stream_mode;
+    v4l2object->no_initial_format = other->no_initial_format;
+    v4l2object->elastic_pool = other->elastic_pool;
+    v4l2object->thumbnail_mode = other->thumbnail_mode;
+    v4l2object->dumpframefile = g_strdup(other->dumpframefile);
+
+    if (other->extra_controls)
+        v4l2object->extra_controls = gst_structure_copy(other->extra_controls);
+
+    if (other->have_set_par && other->par)
+    {
+        v4l2object->par = g_new0(GValue, 1);
+        g_value_init(v4l2object->par, GST_TYPE_FRACTION);
+        g_value_copy(other->par, v4l2object->par);
+        v4l2object->have_set_par = TRUE;
+    }
+
+    return v4l2object;
+}
+
 static gboolean gst_aml_v4l2_object_clear_format_list(GstAmlV4l2Object *v4l2object);
 
 void gst_aml_v4l2_object_destroy(GstAmlV4l2Object *v4l2object)
@@ -796,6 +830,9 @@ gst_aml_v4l2_object_get_property_helper(GstAmlV4l2Object *v4l2object,
     case PROP_STREAM_MODE:
         g_value_set_boolean(value, v4l2object->stream_mode);
         break;
+    case PROP_LOW_LATENCY_MODE:
+        g_value_set_boolean(value, v4l2object->low_latency_mode);
+        break;
     default:
         return FALSE;
         break;
@@ -3524,7 +3561,8 @@ set_amlogic_vdec_parm(GstAmlV4l2Object *v4l2object, struct v4l2_streamparm *stre
         /*set bit18 value to 1
          *release vpp in advance */
         decParm->cfg.metadata_config_flag |= (1 << 18);
-        decParm->cfg.low_latency_mode = v4l2object->low_latency_mode;
+        /* thumbnail mode only feeds keyframes, nothing to reorder */
+        decParm->cfg.low_latency_mode = v4l2object->low_latency_mode || v4l2object->thumbnail_mode;
 
         switch (pixFormat)
         {
@@ -3537,6 +3575,9 @@ set_amlogic_vdec_parm(GstAmlV4l2Object *v4l2object, struct v4l2_streamparm *stre
             case V4L2_PIX_FMT_VP9:
             case V4L2_PIX_FMT_AV1:
                 decParm->cfg.double_write_mode= VDEC_DW_AFBC_AUTO_1_4;
+                /* the linear picture is all a thumbnail needs */
+                if (v4l2object->thumbnail_mode)
+                    decParm->cfg.double_write_mode= VDEC_DW_AFBC_1_4_DW;
                 break;
         }
         env = getenv("V4L2_SET_AMLOGIC_DW_MODE");
@@ -3558,7 +3599,14 @@ set_amlogic_vdec_parm(GstAmlV4l2Object *v4l2object, struct v4l2_streamparm *stre
             }
         }
         GST_DEBUG_OBJECT(v4l2object->dbg_obj, "cfg dw mode to %d", decParm->cfg.double_write_mode);
-        decParm->cfg.ref_buf_margin = GST_AML_V4L2_DEFAULT_CAP_BUF_MARGIN;
+        /* low latency mode makes the driver output in decode order, no
+         * reorder window to cover, so keep fewer spare capture buffers */
+        if (decParm->cfg.low_latency_mode)
+            decParm->cfg.ref_buf_margin = GST_AML_V4L2_LOW_LATENCY_CAP_BUF_MARGIN;
+        else
+            decParm->cfg.ref_buf_margin = GST_AML_V4L2_DEFAULT_CAP_BUF_MARGIN;
+        GST_DEBUG_OBJECT(v4l2object->dbg_obj, "cfg low latency %d ref buf margin %d",
+                         decParm->cfg.low_latency_mode, decParm->cfg.ref_buf_margin);
 
         GstStructure *structure= gst_caps_get_structure(caps, 0);
         if (structure == NULL)
@@ -3865,7 +3913,7 @@ set_amlogic_vdec_parm(GstAmlV4l2Object *v4l2object, struct v4l2_streamparm *stre
     }
 }
 
-static gint gst_aml_v4l2_object_get_dw_mode(GstAmlV4l2Object *v4l2object)
+gint gst_aml_v4l2_object_get_dw_mode(GstAmlV4l2Object *v4l2object)
 {
     struct v4l2_streamparm streamparm;
     struct aml_dec_params *decParm = (struct aml_dec_params *)(&streamparm.parm.raw_data);
@@ -4651,6 +4699,48 @@ gst_aml_v4l2_object_try_format(GstAmlV4l2Object *v4l2object, GstCaps *caps,
     return gst_aml_v4l2_object_set_format_full(v4l2object, caps, TRUE, error);
 }
 
+/**
+ * gst_aml_v4l2_object_try_sizeimage:
+ * @v4l2object: an OUTPUT object with a format set
+ * @width: coded width
+ * @height: coded height
+ *
+ * Ask the driver, with VIDIOC_TRY_FMT, how large a bitstream buffer of the
+ * current format has to be for @width x @height. Does not change the
+ * format, so it can be asked while streaming.
+ *
+ * Returns: the sizeimage of the first plane, 0 when the driver has no answer
+ */
+gsize
+gst_aml_v4l2_object_try_sizeimage(GstAmlV4l2Object *v4l2object, gint width, gint height)
+{
+    struct v4l2_format format = v4l2object->format;
+
+    if (V4L2_TYPE_IS_MULTIPLANAR(v4l2object->type))
+    {
+        format.fmt.pix_mp.width = width;
+        format.fmt.pix_mp.height = height;
+        /* let the driver size it */
+        format.fmt.pix_mp.plane_fmt[0].sizeimage = 0;
+    }
+    else
+    {
+        format.fmt.pix.width = width;
+        format.fmt.pix.height = height;
+        format.fmt.pix.sizeimage = 0;
+    }
+
+    if (v4l2object->ioctl(v4l2object->video_fd, VIDIOC_TRY_FMT, &format) < 0)
+    {
+        GST_DEBUG_OBJECT(v4l2object->dbg_obj, "TRY_FMT %dx%d failed: %s", width, height,
+                         g_strerror(errno));
+        return 0;
+    }
+
+    return V4L2_TYPE_IS_MULTIPLANAR(v4l2object->type) ? format.fmt.pix_mp.plane_fmt[0].sizeimage
+                                                      : format.fmt.pix.sizeimage;
+}
+
 GstFlowReturn
 gst_aml_v4l2_object_poll(GstAmlV4l2Object *v4l2object)
 {
@@ -4700,30 +4790,104 @@ select_error:
 }
 }
 
+/**
+ * gst_aml_v4l2_object_drain_events:
+ * @v4l2object: the object
+ * @fd: the device fd to dequeue from, the object's or its pool's
+ *
+ * Dequeue every pending event in one go. Only call this once poll reported
+ * POLLPRI, then none of the VIDIOC_DQEVENT can block, and v4l2_event.pending
+ * tells when the queue is empty without an extra ioctl. The first
+ * stale_source_changes resolution changes are discarded.
+ *
+ * Returns: a #GstAmlV4l2EventMask of the events seen
+ */
+guint
+gst_aml_v4l2_object_drain_events(GstAmlV4l2Object *v4l2object, gint fd)
+{
+    struct v4l2_event evt;
+    guint mask = 0;
+    guint n = 0, n_stale = 0;
+
+    do
+    {
+        memset(&evt, 0x00, sizeof(struct v4l2_event));
+        if (v4l2object->ioctl(fd, VIDIOC_DQEVENT, &evt) < 0)
+        {
+            if (n == 0)
+                mask |= GST_AML_V4L2_EVENT_ERROR;
+            break;
+        }
+        n++;
+
+        switch (evt.type)
+        {
+        case V4L2_EVENT_SOURCE_CHANGE:
+            if (evt.u.src_change.changes & V4L2_EVENT_SRC_CH_RESOLUTION)
+            {
+                if (v4l2object->stale_source_changes > 0)
+                {
+                    v4l2object->stale_source_changes--;
+                    n_stale++;
+                }
+                else
+                    mask |= GST_AML_V4L2_EVENT_SOURCE_CHANGE;
+            }
+            else
+                GST_WARNING_OBJECT(v4l2object->dbg_obj, "Unknown source change 0x%x - skipped",
+                                   evt.u.src_change.changes);
+            break;
+        case V4L2_EVENT_EOS:
+            mask |= GST_AML_V4L2_EVENT_EOS;
+            break;
+        default:
+            break;
+        }
+    } while (evt.pending > 0);
+
+    GST_LOG_OBJECT(v4l2object->dbg_obj, "drained %u events, %u stale source changes dropped, mask 0x%x",
+                   n, n_stale, mask);
+
+    return mask;
+}
+
+/**
+ * gst_aml_v4l2_object_dqevent:
+ * @v4l2object: the object
+ *
+ * Wait for the device and drain all pending events. Source change wins over
+ * EOS when both are pending.
+ *
+ * Returns: GST_AML_V4L2_FLOW_SOURCE_CHANGE, GST_AML_V4L2_FLOW_LAST_BUFFER,
+ * GST_FLOW_OK when woken without a relevant event, or an error
+ */
 GstFlowReturn
 gst_aml_v4l2_object_dqevent(GstAmlV4l2Object *v4l2object)
 {
     GstFlowReturn res;
-    struct v4l2_event evt;
+    guint mask;
 
     if ((res = gst_aml_v4l2_object_poll(v4l2object)) != GST_FLOW_OK)
         goto poll_failed;
 
-    memset(&evt, 0x00, sizeof(struct v4l2_event));
-    if (v4l2object->ioctl(v4l2object->video_fd, VIDIOC_DQEVENT, &evt) < 0)
-        goto dqevent_failed;
-
-    switch (evt.type)
+    if (v4l2object->can_poll_device &&
+        !gst_poll_fd_can_read_pri(v4l2object->poll, &v4l2object->pollfd))
     {
-    case V4L2_EVENT_SOURCE_CHANGE:
+        /* woken for data only, nothing to dequeue yet. poll reports POLLERR
+         * while neither queue holds buffers, then only a blocking DQEVENT
+         * can wait for the event */
+        if (!gst_poll_fd_has_error(v4l2object->poll, &v4l2object->pollfd))
+            return GST_FLOW_OK;
+    }
+
+    mask = gst_aml_v4l2_object_drain_events(v4l2object, v4l2object->video_fd);
+
+    if (mask & GST_AML_V4L2_EVENT_SOURCE_CHANGE)
         return GST_AML_V4L2_FLOW_SOURCE_CHANGE;
-        break;
-    case V4L2_EVENT_EOS:
+    if (mask & GST_AML_V4L2_EVENT_EOS)
         return GST_AML_V4L2_FLOW_LAST_BUFFER;
-        break;
-    default:
-        break;
-    }
+    if (mask & GST_AML_V4L2_EVENT_ERROR)
+        goto dqevent_failed;
 
     return GST_FLOW_OK;
 
@@ -5404,6 +5568,14 @@ gst_aml_v4l2_object_decide_allocation(GstAmlV4l2Object *obj, GstQuery *query)
             gst_aml_v4l2_buffer_pool_copy_at_threshold(GST_AML_V4L2_BUFFER_POOL(pool),
                                                        FALSE);
         }
+
+        /* Only allocate what downstream and the driver need, the pool creates
+         * more buffers, up to own_min, when the capture queue runs dry */
+        if (obj->elastic_pool)
+        {
+            min = MAX(min, obj->min_buffers);
+            max = own_min;
+        }
     }
     else
     {
@@ -5415,6 +5587,17 @@ gst_aml_v4l2_object_decide_allocation(GstAmlV4l2Object *obj, GstQuery *query)
     if (max != 0)
         max = MAX(min, max);
 
+    /* The CPU only touches our buffers if we copy them out, or if downstream
+     * did not negotiate dmabuf and may map them */
+    if (obj->mode == GST_V4L2_IO_MMAP || obj->mode == GST_V4L2_IO_DMABUF)
+    {
+        GstCapsFeatures *features = caps ? gst_caps_get_features(caps, 0) : NULL;
+        gboolean cpu_access = !pushing_from_our_pool || obj->mode != GST_V4L2_IO_DMABUF ||
+                              !features || !gst_caps_features_contains(features, GST_CAPS_FEATURE_MEMORY_DMABUF);
+
+        gst_aml_v4l2_buffer_pool_set_cpu_access(GST_AML_V4L2_BUFFER_POOL(obj->pool), cpu_access);
+    }
+
     /* First step, configure our own pool */
     config = gst_buffer_pool_get_config(obj->pool);
 
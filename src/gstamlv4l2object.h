@@ -45,6 +45,7 @@ typedef struct _GstAmlV4l2ObjectClassHelper GstAmlV4l2ObjectClassHelper;
 #define GST_AML_V4L2_MAX_AV1_CAP_BUFS 16
 #define GST_AML_V4L2_MAX_VP9_CAP_BUFS 20
 #define GST_AML_V4L2_DEFAULT_CAP_BUF_MARGIN 4
+#define GST_AML_V4L2_LOW_LATENCY_CAP_BUF_MARGIN 2
 
 /* max frame width/height */
 #define GST_AML_V4L2_MAX_SIZE (1 << 15) /* 2^15 == 32768 */
@@ -66,6 +67,14 @@ typedef enum
     GST_V4L2_IO_DMABUF_IMPORT = 5
 } GstAmlV4l2IOMode;
 
+/* events seen by gst_aml_v4l2_object_drain_events() */
+typedef enum
+{
+    GST_AML_V4L2_EVENT_SOURCE_CHANGE = (1 << 0),
+    GST_AML_V4L2_EVENT_EOS = (1 << 1),
+    GST_AML_V4L2_EVENT_ERROR = (1 << 2)
+} GstAmlV4l2EventMask;
+
 typedef gboolean (*GstAmlV4l2GetInOutFunction)(GstAmlV4l2Object *v4l2object, gint *input);
 typedef gboolean (*GstAmlV4l2SetInOutFunction)(GstAmlV4l2Object *v4l2object, gint input);
 typedef gboolean (*GstAmlV4l2UpdateFpsFunction)(GstAmlV4l2Object *v4l2object);
@@ -166,6 +175,14 @@ struct _GstAmlV4l2Object
      * calculate the minimum latency. */
     guint32 min_buffers;
 
+    /* capture pool starts at the minimum and follows the demand with
+     * CREATE_BUFS / REMOVE_BUFS */
+    gboolean elastic_pool;
+
+    /* keyframes only, for thumbnails: smallest double write picture and
+     * output in decode order */
+    gboolean thumbnail_mode;
+
     /* wanted mode */
     GstAmlV4l2IOMode req_mode;
 
@@ -181,6 +198,8 @@ struct _GstAmlV4l2Object
     struct v4l2_capability vcap;
     /* opened device specific capabilities */
     guint32 device_caps;
+    /* video_fd was opened by us, not dup'ed, its query results are cached */
+    gboolean owns_context;
 
     /* lists... */
     GSList *formats; /* list of available capture formats */
@@ -230,7 +249,9 @@ struct _GstAmlV4l2Object
     gboolean skip_try_fmt_probes;
     gboolean can_wait_event;
     gboolean need_wait_event;
-    gboolean need_drop_event;
+    /* resolution V4L2_EVENT_SOURCE_CHANGE the driver still sends for a
+     * stream that already ended, discarded by drain_events() */
+    guint stale_source_changes;
 
     gboolean is_svp;
 
@@ -276,6 +297,8 @@ GstAmlV4l2Object *gst_aml_v4l2_object_new(GstElement *element,
                                           GstAmlV4l2SetInOutFunction set_in_out_func,
                                           GstAmlV4l2UpdateFpsFunction update_fps_func);
 
+GstAmlV4l2Object *gst_aml_v4l2_object_new_like(GstAmlV4l2Object *other);
+
 void gst_aml_v4l2_object_destroy(GstAmlV4l2Object *v4l2object);
 
 /* properties */
@@ -310,6 +333,7 @@ gint gst_aml_v4l2_object_extrapolate_stride(const GstVideoFormatInfo *finfo,
 
 gboolean gst_aml_v4l2_object_set_format(GstAmlV4l2Object *v4l2object, GstCaps *caps, GstAmlV4l2Error *error);
 gboolean gst_aml_v4l2_object_try_format(GstAmlV4l2Object *v4l2object, GstCaps *caps, GstAmlV4l2Error *error);
+gsize gst_aml_v4l2_object_try_sizeimage(GstAmlV4l2Object *v4l2object, gint width, gint height);
 gboolean gst_aml_v4l2_object_try_import(GstAmlV4l2Object *v4l2object, GstBuffer *buffer);
 
 gboolean gst_aml_v4l2_object_caps_equal(GstAmlV4l2Object *v4l2object, GstCaps *caps);
@@ -325,6 +349,7 @@ GstCaps *gst_aml_v4l2_object_probe_caps(GstAmlV4l2Object *v4l2object, GstCaps *f
 GstCaps *gst_aml_v4l2_object_get_caps(GstAmlV4l2Object *v4l2object, GstCaps *filter);
 
 GstFlowReturn gst_aml_v4l2_object_dqevent(GstAmlV4l2Object *v4l2object);
+guint gst_aml_v4l2_object_drain_events(GstAmlV4l2Object *v4l2object, gint fd);
 gboolean gst_aml_v4l2_object_acquire_format(GstAmlV4l2Object *v4l2object, GstVideoInfo *info);
 
 gboolean gst_aml_v4l2_object_set_crop(GstAmlV4l2Object *obj);
@@ -359,6 +384,7 @@ gboolean gst_aml_v4l2_set_controls(GstAmlV4l2Object *v4l2object, GstStructure *c
 gboolean gst_aml_v4l2_set_drm_mode(GstAmlV4l2Object *v4l2object);
 gboolean gst_aml_v4l2_set_stream_mode(GstAmlV4l2Object *v4l2object);
 gint gst_aml_v4l2_object_get_outstanding_capture_buf_num(GstAmlV4l2Object *v4l2object);
+gint gst_aml_v4l2_object_get_dw_mode(GstAmlV4l2Object *v4l2object);
 
 G_END_DECLS
 
@@ -95,6 +95,25 @@ enum
 {
     PROP_0,
     V4L2_STD_OBJECT_PROPS,
+    PROP_FAST_START,
+    PROP_DECODED_PTS_INTERVAL,
+    PROP_SHARED_REACTOR,
+    PROP_CPU_AFFINITY,
+    PROP_SCHED_POLICY,
+    PROP_SCHED_PRIORITY,
+    PROP_NICE,
+    PROP_THREAD_NAME,
+    PROP_ELASTIC_POOL,
+    PROP_STANDBY_CAPS,
+    PROP_THUMBNAIL_INTERVAL,
+    PROP_THUMBNAIL_KEYFRAMES,
+    PROP_DECODE_ONLY,
+    PROP_DECODE_CHECKSUM,
+    PROP_DECODE_STATS,
+    PROP_ERROR_POLICY,
+    PROP_RESYNC_THRESHOLD,
+    PROP_ERROR_STATS,
+    PROP_CAPTURE_POOL_STAT,
 #if GST_IMPORT_LGE_PROP
     LGE_RESOURCE_INFO,
     LGE_DECODE_SIZE,
@@ -107,16 +126,43 @@ enum
 enum
 {
   SIGNAL_DECODED_PTS,
+  SIGNAL_DUMP_POOL_STAT,
   MAX_SIGNAL
 };
 
 static guint g_signals[MAX_SIGNAL]= {0};
 
+GType
+gst_aml_v4l2_error_policy_get_type(void)
+{
+    static GType error_policy = 0;
+
+    if (!error_policy)
+    {
+        static const GEnumValue error_policies[] = {
+            {GST_AML_V4L2_ERROR_CONCEAL, "Output the concealed picture", "conceal"},
+            {GST_AML_V4L2_ERROR_REPEAT, "Repeat the last good picture", "repeat"},
+            {GST_AML_V4L2_ERROR_DROP, "Drop the frame", "drop"},
+            {0, NULL, NULL}};
+
+        error_policy = g_enum_register_static("GstAmlV4l2ErrorPolicy", error_policies);
+    }
+    return error_policy;
+}
+
 #define gst_aml_v4l2_video_dec_parent_class parent_class
 G_DEFINE_ABSTRACT_TYPE(GstAmlV4l2VideoDec, gst_aml_v4l2_video_dec,
                        GST_TYPE_VIDEO_DECODER);
 
 static GstFlowReturn gst_aml_v4l2_video_dec_finish(GstVideoDecoder *decoder);
+static void gst_aml_v4l2_video_dec_heap_clear(GstAmlV4l2VideoDec *self);
+static void gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder);
+static void gst_aml_v4l2_video_dec_set_standby_caps(GstAmlV4l2VideoDec *self, GstCaps *caps);
+static void gst_aml_v4l2_video_dec_standby_discard(GstAmlV4l2VideoDec *self);
+static void gst_aml_v4l2_video_dec_standby_join(GstAmlV4l2VideoDec *self);
+static GstStructure *gst_aml_v4l2_video_dec_decode_stats(GstAmlV4l2VideoDec *self);
+static GstStructure *gst_aml_v4l2_video_dec_error_stats(GstAmlV4l2VideoDec *self);
+static GstStructure *gst_aml_v4l2_video_dec_capture_pool_stat(GstAmlV4l2VideoDec *self);
 #if GST_IMPORT_LGE_PROP
 static void gst_aml_v4l2_video_dec_install_lge_properties_helper(GObjectClass *gobject_class);
 #endif
@@ -143,6 +189,75 @@ gst_aml_v4l2_video_dec_set_property(GObject *object,
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         }
         break;
+    case PROP_FAST_START:
+        self->fast_start = g_value_get_boolean(value);
+        break;
+    case PROP_DECODED_PTS_INTERVAL:
+        self->decoded_pts_interval = g_value_get_uint(value);
+        break;
+    case PROP_SHARED_REACTOR:
+        /* the capture loop owner can't change while it runs */
+        if (GST_STATE(self) <= GST_STATE_READY)
+            self->shared_reactor = g_value_get_boolean(value);
+        else
+            GST_WARNING_OBJECT(self, "shared-reactor can only be changed in READY or NULL");
+        break;
+    case PROP_CPU_AFFINITY:
+        GST_OBJECT_LOCK(self);
+        g_free(self->sched.cpu_affinity);
+        self->sched.cpu_affinity = g_value_dup_string(value);
+        GST_OBJECT_UNLOCK(self);
+        break;
+    case PROP_SCHED_POLICY:
+        GST_OBJECT_LOCK(self);
+        self->sched.policy = g_value_get_enum(value);
+        GST_OBJECT_UNLOCK(self);
+        break;
+    case PROP_SCHED_PRIORITY:
+        GST_OBJECT_LOCK(self);
+        self->sched.priority = g_value_get_int(value);
+        GST_OBJECT_UNLOCK(self);
+        break;
+    case PROP_NICE:
+        GST_OBJECT_LOCK(self);
+        self->sched.nice = g_value_get_int(value);
+        GST_OBJECT_UNLOCK(self);
+        break;
+    case PROP_THREAD_NAME:
+        GST_OBJECT_LOCK(self);
+        g_free(self->sched.thread_name);
+        self->sched.thread_name = g_value_dup_string(value);
+        GST_OBJECT_UNLOCK(self);
+        break;
+    case PROP_ELASTIC_POOL:
+        self->v4l2capture->elastic_pool = g_value_get_boolean(value);
+        break;
+    case PROP_STANDBY_CAPS:
+        gst_aml_v4l2_video_dec_set_standby_caps(self, gst_value_get_caps(value));
+        break;
+    case PROP_THUMBNAIL_INTERVAL:
+        self->thumbnail_interval = g_value_get_uint(value);
+        self->v4l2output->thumbnail_mode = (self->thumbnail_interval > 0);
+        break;
+    case PROP_THUMBNAIL_KEYFRAMES:
+        self->thumbnail_keyframes = g_value_get_boolean(value);
+        break;
+    case PROP_DECODE_ONLY:
+        /* decides how the capture side is set up */
+        if (GST_STATE(self) <= GST_STATE_READY)
+            self->decode_only = g_value_get_boolean(value);
+        else
+            GST_WARNING_OBJECT(self, "decode-only can only be changed in READY or NULL");
+        break;
+    case PROP_DECODE_CHECKSUM:
+        self->decode_checksum = g_value_get_boolean(value);
+        break;
+    case PROP_ERROR_POLICY:
+        self->error_policy = g_value_get_enum(value);
+        break;
+    case PROP_RESYNC_THRESHOLD:
+        self->resync_threshold = g_value_get_uint(value);
+        break;
 #if GST_IMPORT_LGE_PROP
     case LGE_RESOURCE_INFO:
     {
@@ -210,6 +325,69 @@ gst_aml_v4l2_video_dec_get_property(GObject *object,
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         }
         break;
+    case PROP_FAST_START:
+        g_value_set_boolean(value, self->fast_start);
+        break;
+    case PROP_DECODED_PTS_INTERVAL:
+        g_value_set_uint(value, self->decoded_pts_interval);
+        break;
+    case PROP_SHARED_REACTOR:
+        g_value_set_boolean(value, self->shared_reactor);
+        break;
+    case PROP_CPU_AFFINITY:
+        GST_OBJECT_LOCK(self);
+        g_value_set_string(value, self->sched.cpu_affinity);
+        GST_OBJECT_UNLOCK(self);
+        break;
+    case PROP_SCHED_POLICY:
+        g_value_set_enum(value, self->sched.policy);
+        break;
+    case PROP_SCHED_PRIORITY:
+        g_value_set_int(value, self->sched.priority);
+        break;
+    case PROP_NICE:
+        g_value_set_int(value, self->sched.nice);
+        break;
+    case PROP_THREAD_NAME:
+        GST_OBJECT_LOCK(self);
+        g_value_set_string(value, self->sched.thread_name);
+        GST_OBJECT_UNLOCK(self);
+        break;
+    case PROP_ELASTIC_POOL:
+        g_value_set_boolean(value, self->v4l2capture->elastic_pool);
+        break;
+    case PROP_STANDBY_CAPS:
+        g_mutex_lock(&self->standby_lock);
+        gst_value_set_caps(value, self->standby_caps);
+        g_mutex_unlock(&self->standby_lock);
+        break;
+    case PROP_THUMBNAIL_INTERVAL:
+        g_value_set_uint(value, self->thumbnail_interval);
+        break;
+    case PROP_THUMBNAIL_KEYFRAMES:
+        g_value_set_boolean(value, self->thumbnail_keyframes);
+        break;
+    case PROP_DECODE_ONLY:
+        g_value_set_boolean(value, self->decode_only);
+        break;
+    case PROP_DECODE_CHECKSUM:
+        g_value_set_boolean(value, self->decode_checksum);
+        break;
+    case PROP_DECODE_STATS:
+        g_value_take_boxed(value, gst_aml_v4l2_video_dec_decode_stats(self));
+        break;
+    case PROP_ERROR_POLICY:
+        g_value_set_enum(value, self->error_policy);
+        break;
+    case PROP_RESYNC_THRESHOLD:
+        g_value_set_uint(value, self->resync_threshold);
+        break;
+    case PROP_ERROR_STATS:
+        g_value_take_boxed(value, gst_aml_v4l2_video_dec_error_stats(self));
+        break;
+    case PROP_CAPTURE_POOL_STAT:
+        g_value_take_boxed(value, gst_aml_v4l2_video_dec_capture_pool_stat(self));
+        break;
 
 #if GST_IMPORT_LGE_PROP
     case LGE_DECODE_SIZE:
@@ -247,6 +425,8 @@ gst_aml_v4l2_video_dec_open(GstVideoDecoder *decoder)
 
     GST_DEBUG_OBJECT(self, "Opening");
 
+    self->first_frame_start = gst_util_get_timestamp();
+
     if (!gst_aml_v4l2_object_open(self->v4l2output))
         goto failure;
 
@@ -254,9 +434,19 @@ gst_aml_v4l2_video_dec_open(GstVideoDecoder *decoder)
         goto failure;
 
     codec_caps = gst_pad_get_pad_template_caps(decoder->sinkpad);
-    self->probed_sinkcaps = gst_aml_v4l2_object_probe_caps(self->v4l2output,
-                                                           codec_caps);
-    gst_caps_unref(codec_caps);
+    if (self->fast_start)
+    {
+        /* The template caps were enumerated from the device at register time,
+         * trust them and skip the per-format probing ioctls */
+        GST_DEBUG_OBJECT(self, "fast start, use sink template caps");
+        self->probed_sinkcaps = codec_caps;
+    }
+    else
+    {
+        self->probed_sinkcaps = gst_aml_v4l2_object_probe_caps(self->v4l2output,
+                                                               codec_caps);
+        gst_caps_unref(codec_caps);
+    }
 
     if (gst_caps_is_empty(self->probed_sinkcaps))
         goto no_encoded_format;
@@ -290,6 +480,11 @@ gst_aml_v4l2_video_dec_close(GstVideoDecoder *decoder)
 
     GST_DEBUG_OBJECT(self, "Closing");
 
+    gst_aml_v4l2_video_dec_standby_join(self);
+    g_mutex_lock(&self->standby_lock);
+    gst_aml_v4l2_video_dec_standby_discard(self);
+    g_mutex_unlock(&self->standby_lock);
+
     gst_aml_v4l2_object_close(self->v4l2output);
     gst_aml_v4l2_object_close(self->v4l2capture);
     gst_caps_replace(&self->probed_srccaps, NULL);
@@ -308,10 +503,157 @@ gst_aml_v4l2_video_dec_start(GstVideoDecoder *decoder)
     gst_aml_v4l2_object_unlock(self->v4l2output);
     g_atomic_int_set(&self->active, TRUE);
     self->output_flow = GST_FLOW_OK;
+    self->thumbnail_count = 0;
+    self->thumbnail_last = GST_CLOCK_TIME_NONE;
+
+    GST_OBJECT_LOCK(self);
+    self->decoded_frames = 0;
+    self->decoded_corrupted = 0;
+    self->decode_start = GST_CLOCK_TIME_NONE;
+    self->decode_last = GST_CLOCK_TIME_NONE;
+    if (self->decoded_checksum)
+    {
+        g_checksum_free(self->decoded_checksum);
+        self->decoded_checksum = NULL;
+    }
+    self->errors_truncated = 0;
+    self->errors_decode = 0;
+    self->errors_concealed = 0;
+    self->errors_repeated = 0;
+    self->errors_dropped = 0;
+    self->resyncs = 0;
+    self->resync_discarded = 0;
+    GST_OBJECT_UNLOCK(self);
+    self->error_burst = 0;
+    g_atomic_int_set(&self->resync_pending, FALSE);
 
     return TRUE;
 }
 
+static gboolean
+gst_aml_v4l2_video_dec_reactor_dispatch(gpointer user_data)
+{
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(user_data);
+    gboolean keep;
+
+    /* one iteration of the capture loop, the fd is ready so it won't block
+     * on the driver */
+    gst_aml_v4l2_video_dec_loop(GST_VIDEO_DECODER(self));
+
+    g_mutex_lock(&self->reactor_lock);
+    keep = (self->reactor_state == GST_TASK_STARTED);
+    if (!keep)
+        g_cond_broadcast(&self->reactor_cond);
+    g_mutex_unlock(&self->reactor_lock);
+
+    return keep;
+}
+
+static GstTaskState
+gst_aml_v4l2_video_dec_get_task_state(GstAmlV4l2VideoDec *self)
+{
+    GstTaskState state;
+
+    if (!self->shared_reactor)
+        return gst_pad_get_task_state(GST_VIDEO_DECODER_SRC_PAD(self));
+
+    g_mutex_lock(&self->reactor_lock);
+    state = self->reactor_state;
+    g_mutex_unlock(&self->reactor_lock);
+
+    return state;
+}
+
+static gboolean
+gst_aml_v4l2_video_dec_start_task(GstAmlV4l2VideoDec *self)
+{
+    if (!self->shared_reactor)
+        return gst_pad_start_task(GST_VIDEO_DECODER_SRC_PAD(self),
+                                  (GstTaskFunction)gst_aml_v4l2_video_dec_loop, self, NULL);
+
+    g_mutex_lock(&self->reactor_lock);
+    if (!self->reactor_src)
+    {
+        if (!self->reactor)
+            self->reactor = gst_aml_v4l2_reactor_ref_default();
+        if (self->reactor)
+            self->reactor_src = gst_aml_v4l2_reactor_add(self->reactor, self->v4l2capture->video_fd,
+                                                         gst_aml_v4l2_video_dec_reactor_dispatch, self);
+        if (!self->reactor_src)
+        {
+            g_mutex_unlock(&self->reactor_lock);
+            return FALSE;
+        }
+    }
+    self->reactor_state = GST_TASK_STARTED;
+    g_mutex_unlock(&self->reactor_lock);
+
+    return gst_aml_v4l2_reactor_arm(self->reactor, self->reactor_src);
+}
+
+static void
+gst_aml_v4l2_video_dec_pause_task(GstAmlV4l2VideoDec *self)
+{
+    if (!self->shared_reactor)
+    {
+        gst_pad_pause_task(GST_VIDEO_DECODER_SRC_PAD(self));
+        return;
+    }
+
+    /* called from the dispatch, which then leaves the source disarmed */
+    g_mutex_lock(&self->reactor_lock);
+    if (self->reactor_state == GST_TASK_STARTED)
+        self->reactor_state = GST_TASK_PAUSED;
+    g_mutex_unlock(&self->reactor_lock);
+}
+
+static void
+gst_aml_v4l2_video_dec_stop_task(GstAmlV4l2VideoDec *self)
+{
+    GstAmlV4l2ReactorSource *source;
+    GstAmlV4l2Reactor *reactor;
+
+    if (!self->shared_reactor)
+    {
+        gst_pad_stop_task(GST_VIDEO_DECODER_SRC_PAD(self));
+        return;
+    }
+
+    g_mutex_lock(&self->reactor_lock);
+    self->reactor_state = GST_TASK_STOPPED;
+    source = self->reactor_src;
+    reactor = self->reactor;
+    self->reactor_src = NULL;
+    g_cond_broadcast(&self->reactor_cond);
+    g_mutex_unlock(&self->reactor_lock);
+
+    /* waits for a dispatch in flight, like joining the task thread. The
+     * capture fd may change before the next start, the reactor itself is
+     * kept until finalize so flushes don't restart it */
+    if (source)
+        gst_aml_v4l2_reactor_remove(reactor, source);
+}
+
+static void
+gst_aml_v4l2_video_dec_wait_task(GstAmlV4l2VideoDec *self)
+{
+    if (!self->shared_reactor)
+    {
+        GstTask *task = GST_VIDEO_DECODER_SRC_PAD(self)->task;
+
+        GST_OBJECT_LOCK(task);
+        while (GST_TASK_STATE(task) == GST_TASK_STARTED)
+            GST_TASK_WAIT(task);
+        GST_OBJECT_UNLOCK(task);
+        return;
+    }
+
+    g_mutex_lock(&self->reactor_lock);
+    while (self->reactor_state == GST_TASK_STARTED)
+        g_cond_wait(&self->reactor_cond, &self->reactor_lock);
+    g_mutex_unlock(&self->reactor_lock);
+}
+
 static gboolean
 gst_aml_v4l2_video_dec_stop(GstVideoDecoder *decoder)
 {
@@ -323,7 +665,7 @@ gst_aml_v4l2_video_dec_stop(GstVideoDecoder *decoder)
     gst_aml_v4l2_object_unlock(self->v4l2capture);
 
     /* Wait for capture thread to stop */
-    gst_pad_stop_task(decoder->srcpad);
+    gst_aml_v4l2_video_dec_stop_task(self);
 
     GST_VIDEO_DECODER_STREAM_LOCK(decoder);
     self->output_flow = GST_FLOW_OK;
@@ -332,6 +674,7 @@ gst_aml_v4l2_video_dec_stop(GstVideoDecoder *decoder)
     /* Should have been flushed already */
     g_assert(g_atomic_int_get(&self->active) == FALSE);
 
+    gst_buffer_replace(&self->last_good, NULL);
     gst_aml_v4l2_object_stop(self->v4l2output);
     gst_aml_v4l2_object_stop(self->v4l2capture);
 
@@ -341,6 +684,11 @@ gst_aml_v4l2_video_dec_stop(GstVideoDecoder *decoder)
         self->input_state = NULL;
     }
 
+    gst_caps_replace(&self->predicted_caps, NULL);
+    g_atomic_int_set(&self->header_parsed, FALSE);
+    gst_aml_v4l2_video_dec_heap_clear(self);
+    gst_aml_v4l2_timestamp_reset(&self->ts);
+
     GST_DEBUG_OBJECT(self, "Stopped");
 
     return TRUE;
@@ -409,167 +757,647 @@ done:
     return ret;
 }
 
+/* HEVC, VP9 and AV1 decoders find a new size in the bitstream and report it
+ * with V4L2_EVENT_SOURCE_CHANGE, the capture loop then reconfigures on its
+ * own. Such a change needs no drain as long as nothing but the picture
+ * parameters differ and the OUTPUT buffers, sized for the old resolution,
+ * still hold an access unit of the new one. */
 static gboolean
-gst_aml_v4l2_video_dec_set_format(GstVideoDecoder *decoder,
-                                  GstVideoCodecState *state)
+gst_aml_v4l2_video_dec_inband_res_chg(GstAmlV4l2VideoDec *self,
+                                      GstVideoCodecState *state)
 {
-    GstAmlV4l2Error error = GST_AML_V4L2_ERROR_INIT;
-    gboolean ret = TRUE;
-    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
-    GstCaps *caps;
+    static const gchar *const inband_codecs[] = {"video/x-h265", "video/x-vp9", "video/x-av1", NULL};
+    GstStructure *s_old, *s_new;
+    gboolean ret;
 
-    GST_DEBUG_OBJECT(self, "Setting format: %" GST_PTR_FORMAT, state->caps);
-    if (self->input_state)
+    if (!self->v4l2capture->can_wait_event || !GST_AML_V4L2_IS_ACTIVE(self->v4l2output))
+        return FALSE;
+
+    if (g_getenv("GST_V4L2_FORCE_DRAIN"))
+        return FALSE;
+
+    if (!gst_caps_features_is_equal(gst_caps_get_features(self->input_state->caps, 0),
+                                    gst_caps_get_features(state->caps, 0)))
+        return FALSE;
+
+    s_old = gst_structure_copy(gst_caps_get_structure(self->input_state->caps, 0));
+    s_new = gst_structure_copy(gst_caps_get_structure(state->caps, 0));
+
+    if (!g_strv_contains(inband_codecs, gst_structure_get_name(s_new)))
     {
-        if (gst_aml_v4l2_video_dec_res_chg(decoder,state) || gst_aml_v4l2_video_dec_codec_chg(decoder,state))
-            GST_DEBUG_OBJECT(self, "resolution or codec changed");
-        else
-            goto done;
+        ret = FALSE;
+        goto done;
     }
 
-    GstCapsFeatures *const features = gst_caps_get_features(state->caps, 0);
-    GstStructure *s = gst_caps_get_structure(state->caps,0);
-    if (s && gst_structure_has_field(s,"format"))
+    gst_structure_remove_fields(s_old, "width", "height", "framerate", "pixel-aspect-ratio",
+                                "codec_data", "profile", "level", "tier", NULL);
+    gst_structure_remove_fields(s_new, "width", "height", "framerate", "pixel-aspect-ratio",
+                                "codec_data", "profile", "level", "tier", NULL);
+    ret = gst_structure_is_equal(s_old, s_new);
+
+    /* imported input buffers come sized by upstream */
+    if (ret && self->v4l2output->mode != GST_V4L2_IO_DMABUF_IMPORT)
     {
-        if (!strcmp("XVID",gst_structure_get_string(s,"format")))
-        {
-            GST_DEBUG_OBJECT(self, "This is a DIVX file, cannot support");
-            ret = FALSE;
-            goto done;
-        }
+        gsize size = gst_aml_v4l2_object_try_sizeimage(self->v4l2output,
+                                                       GST_VIDEO_INFO_WIDTH(&state->info),
+                                                       GST_VIDEO_INFO_HEIGHT(&state->info));
+
+        GST_DEBUG_OBJECT(self, "%dx%d needs %" G_GSIZE_FORMAT " byte OUTPUT buffers, have %" G_GSIZE_FORMAT,
+                         GST_VIDEO_INFO_WIDTH(&state->info), GST_VIDEO_INFO_HEIGHT(&state->info),
+                         size, self->v4l2output->info.size);
+        ret = size > 0 && size <= self->v4l2output->info.size;
     }
 
-    if (gst_caps_features_contains(features, GST_CAPS_FEATURE_MEMORY_DMABUF))
-        self->v4l2output->req_mode = GST_V4L2_IO_DMABUF_IMPORT;
+done:
+    gst_structure_free(s_old);
+    gst_structure_free(s_new);
+    return ret;
+}
 
-    if (self->input_state)
-    {
-        if (gst_aml_v4l2_object_caps_equal(self->v4l2output, state->caps))
-        {
-            GST_DEBUG_OBJECT(self, "Compatible caps");
-            goto done;
-        }
-        gst_video_codec_state_unref(self->input_state);
-        self->input_state = NULL;
+/* Warm standby: a second context on the device, opened and configured for
+ * the hinted caps on a helper thread while the current stream plays. When
+ * set_format sees those caps it replaces the current context without
+ * draining the old stream. */
 
-        gst_aml_v4l2_video_dec_finish(decoder);
-        gst_aml_v4l2_object_stop(self->v4l2output);
+/* The objects of a swapped out context, freed along with the last of their
+ * pools and allocators, which downstream may keep for a while */
+typedef struct
+{
+    gint refs;
+    GstAmlV4l2Object *output;
+    GstAmlV4l2Object *capture;
+} GstAmlV4l2VideoDecRetired;
 
-        /* The renegotiation flow don't blend with the base class flow. To properly
-         * stop the capture pool, if the buffers can't be orphaned, we need to
-         * reclaim our buffers, which will happend through the allocation query.
-         * The allocation query is triggered by gst_video_decoder_negotiate() which
-         * requires the output caps to be set, but we can't know this information
-         * as we rely on the decoder, which requires the capture queue to be
-         * stopped.
-         *
-         * To workaround this issue, we simply run an allocation query with the
-         * old negotiated caps in order to drain/reclaim our buffers. That breaks
-         * the complexity and should not have much impact in performance since the
-         * following allocation query will happen on a drained pipeline and won't
-         * block. */
-        if (self->v4l2capture->pool &&
-            !gst_aml_v4l2_buffer_pool_orphan(&self->v4l2capture->pool))
-        {
-            GstCaps *caps = gst_pad_get_current_caps(decoder->srcpad);
-            if (caps)
-            {
-                GstQuery *query = gst_query_new_allocation(caps, FALSE);
-                gst_pad_peer_query(decoder->srcpad, query);
-                gst_query_unref(query);
-                gst_caps_unref(caps);
-            }
-        }
+static void
+gst_aml_v4l2_video_dec_retired_unref(gpointer data)
+{
+    GstAmlV4l2VideoDecRetired *retired = data;
 
-        gst_aml_v4l2_object_stop(self->v4l2capture);
-        self->output_flow = GST_FLOW_OK;
-    }
+    if (!g_atomic_int_dec_and_test(&retired->refs))
+        return;
 
-    if ((ret = gst_aml_v4l2_set_drm_mode(self->v4l2output)) == FALSE)
+    GST_DEBUG("freeing swapped out context");
+    gst_aml_v4l2_object_destroy(retired->output);
+    gst_aml_v4l2_object_destroy(retired->capture);
+    g_free(retired);
+}
+
+static void
+gst_aml_v4l2_video_dec_standby_discard(GstAmlV4l2VideoDec *self)
+{
+    if (self->standby_output)
     {
-        GST_ERROR_OBJECT(self, "config output drm mode error");
-        goto done;
+        gst_aml_v4l2_object_stop(self->standby_output);
+        if (GST_AML_V4L2_IS_OPEN(self->standby_output))
+            gst_aml_v4l2_object_close(self->standby_output);
+        gst_aml_v4l2_object_destroy(self->standby_output);
+        self->standby_output = NULL;
     }
 
-    if ((ret = gst_aml_v4l2_set_stream_mode(self->v4l2output)) == FALSE)
+    if (self->standby_capture)
     {
-        GST_ERROR_OBJECT(self, "config output stream mode error");
-        goto done;
+        if (GST_AML_V4L2_IS_OPEN(self->standby_capture))
+            gst_aml_v4l2_object_close(self->standby_capture);
+        gst_aml_v4l2_object_destroy(self->standby_capture);
+        self->standby_capture = NULL;
     }
 
-    ret = gst_aml_v4l2_object_set_format(self->v4l2output, state->caps, &error);
-
-    gst_caps_replace(&self->probed_srccaps, NULL);
-    self->probed_srccaps = gst_aml_v4l2_object_probe_caps(self->v4l2capture,
-                                                          gst_aml_v4l2_object_get_raw_caps());
+    gst_caps_replace(&self->standby_srccaps, NULL);
+    self->standby_ready = FALSE;
+}
 
-    if (gst_caps_is_empty(self->probed_srccaps))
-        goto no_raw_format;
+/* Copies the settings of the current objects into new standby ones. Called
+ * with the stream lock and standby_lock held: the streaming thread may
+ * change the current objects, the helper thread only sees the copies.
+ * FALSE when there is nothing to prepare */
+static gboolean
+gst_aml_v4l2_video_dec_standby_clone(GstAmlV4l2VideoDec *self)
+{
+    gst_aml_v4l2_video_dec_standby_discard(self);
 
-    caps = gst_caps_copy(self->probed_srccaps);
-    gst_caps_set_features_simple(caps, gst_caps_features_from_string(GST_CAPS_FEATURE_MEMORY_DMABUF));
-    gst_caps_append(self->probed_srccaps, caps);
-    if (ret)
-        self->input_state = gst_video_codec_state_ref(state);
-    else
-        gst_aml_v4l2_error(self, &error);
+    if (!self->standby_caps || !GST_AML_V4L2_IS_OPEN(self->v4l2output))
+        return FALSE;
 
-done:
-    return ret;
+    self->standby_output = gst_aml_v4l2_object_new_like(self->v4l2output);
+    self->standby_capture = gst_aml_v4l2_object_new_like(self->v4l2capture);
+    self->standby_capture->need_wait_event = TRUE;
+    self->standby_capture->stale_source_changes = 0;
 
-no_raw_format:
-    GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS,
-                      (_("Decoder on device %s has no supported output format"),
-                       self->v4l2output->videodev),
-                      (NULL));
-    return GST_FLOW_ERROR;
+    return TRUE;
 }
 
-static gboolean
-gst_aml_v4l2_video_dec_flush(GstVideoDecoder *decoder)
+/* Opens and configures the objects made by standby_clone(), only touches
+ * those */
+static void
+gst_aml_v4l2_video_dec_standby_prepare(GstAmlV4l2VideoDec *self)
 {
-    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
+    GstAmlV4l2Error error = GST_AML_V4L2_ERROR_INIT;
+    GstAmlV4l2Object *output, *capture;
+    GstCapsFeatures *features;
+    GstBufferPool *pool;
+    GstStructure *config;
+    GstCaps *caps;
 
-    GST_DEBUG_OBJECT(self, "Flushed");
+    g_mutex_lock(&self->standby_lock);
 
-    /* Ensure the processing thread has stopped for the reverse playback
-     * discount case */
-    if (gst_pad_get_task_state(decoder->srcpad) == GST_TASK_STARTED)
-    {
-        GST_VIDEO_DECODER_STREAM_UNLOCK(decoder);
+    output = self->standby_output;
+    capture = self->standby_capture;
+    if (!output || !capture || !self->standby_caps)
+        goto done;
 
-        gst_aml_v4l2_object_unlock(self->v4l2output);
-        gst_aml_v4l2_object_unlock(self->v4l2capture);
-        gst_pad_stop_task(decoder->srcpad);
-        GST_VIDEO_DECODER_STREAM_LOCK(decoder);
-    }
+    GST_DEBUG_OBJECT(self, "preparing standby context for %" GST_PTR_FORMAT, self->standby_caps);
 
-    self->output_flow = GST_FLOW_OK;
+    if (!gst_aml_v4l2_object_open(output) ||
+        !gst_aml_v4l2_object_open_shared(capture, output))
+        goto failed;
 
-    gst_aml_v4l2_object_unlock_stop(self->v4l2output);
-    gst_aml_v4l2_object_unlock_stop(self->v4l2capture);
+    features = gst_caps_get_features(self->standby_caps, 0);
+    if (gst_caps_features_contains(features, GST_CAPS_FEATURE_MEMORY_DMABUF))
+        output->req_mode = GST_V4L2_IO_DMABUF_IMPORT;
 
-    if (self->v4l2output->pool)
-        gst_aml_v4l2_buffer_pool_flush(self->v4l2output->pool);
+    if (!gst_aml_v4l2_set_drm_mode(output) || !gst_aml_v4l2_set_stream_mode(output))
+        goto failed;
 
-    /* gst_aml_v4l2_buffer_pool_flush() calls streamon the capture pool and must be
-     * called after gst_aml_v4l2_object_unlock_stop() stopped flushing the buffer
-     * pool. */
-    if (self->v4l2capture->pool)
-        gst_aml_v4l2_buffer_pool_flush(self->v4l2capture->pool);
+    if (!gst_aml_v4l2_object_set_format(output, self->standby_caps, &error))
+        goto failed;
 
-    return TRUE;
-}
+    self->standby_srccaps = gst_aml_v4l2_object_probe_caps(capture,
+                                                           gst_aml_v4l2_object_get_raw_caps());
+    if (gst_caps_is_empty(self->standby_srccaps))
+        goto failed;
 
-static gboolean
-gst_aml_v4l2_video_dec_negotiate(GstVideoDecoder *decoder)
-{
-    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
+    caps = gst_caps_copy(self->standby_srccaps);
+    gst_caps_set_features_simple(caps, gst_caps_features_from_string(GST_CAPS_FEATURE_MEMORY_DMABUF));
+    gst_caps_append(self->standby_srccaps, caps);
 
-    if (TRUE == self->v4l2output->is_svp)
-    {
-        GstStructure *s;
-        GstEvent *event;
+    /* allocate the OUTPUT buffers now, handle_frame finds the pool active */
+    pool = GST_BUFFER_POOL(output->pool);
+    config = gst_buffer_pool_get_config(pool);
+    gst_buffer_pool_config_set_params(config, self->standby_caps, output->info.size,
+                                      output->min_buffers, output->min_buffers);
+    if (!gst_buffer_pool_set_config(pool, config) || !gst_buffer_pool_set_active(pool, TRUE))
+        goto failed;
+
+    GST_DEBUG_OBJECT(self, "standby context ready");
+    self->standby_ready = TRUE;
+    goto done;
+
+failed:
+{
+    GST_WARNING_OBJECT(self, "failed to prepare standby context, next switch drains");
+    gst_aml_v4l2_clear_error(&error);
+    gst_aml_v4l2_video_dec_standby_discard(self);
+    goto done;
+}
+done:
+    g_mutex_unlock(&self->standby_lock);
+}
+
+static gpointer
+gst_aml_v4l2_video_dec_standby_thread(gpointer data)
+{
+    gst_aml_v4l2_video_dec_standby_prepare(GST_AML_V4L2_VIDEO_DEC(data));
+    return NULL;
+}
+
+static void
+gst_aml_v4l2_video_dec_standby_join(GstAmlV4l2VideoDec *self)
+{
+    GThread *thread;
+
+    g_mutex_lock(&self->standby_lock);
+    thread = self->standby_thread;
+    self->standby_thread = NULL;
+    g_mutex_unlock(&self->standby_lock);
+
+    if (thread)
+        g_thread_join(thread);
+}
+
+/* Starts preparing the standby context on the helper thread once a stream
+ * runs and a hint is set: before that there is nothing to clone and no
+ * reason to hold a second decoder instance. Called with the stream lock and
+ * standby_lock held */
+static void
+gst_aml_v4l2_video_dec_standby_schedule(GstAmlV4l2VideoDec *self)
+{
+    if (self->standby_thread || self->standby_output || !self->input_state)
+        return;
+
+    if (gst_aml_v4l2_video_dec_standby_clone(self))
+        self->standby_thread = g_thread_new("aml-v4l2-standby",
+                                            gst_aml_v4l2_video_dec_standby_thread, self);
+}
+
+/* The hint may arrive on any thread, opening and configuring the device is
+ * left to the helper thread. It never takes the stream lock, and only
+ * set_format, which holds it, starts another one */
+static void
+gst_aml_v4l2_video_dec_set_standby_caps(GstAmlV4l2VideoDec *self, GstCaps *caps)
+{
+    GST_VIDEO_DECODER_STREAM_LOCK(self);
+    gst_aml_v4l2_video_dec_standby_join(self);
+
+    g_mutex_lock(&self->standby_lock);
+    gst_caps_replace(&self->standby_caps, caps);
+    gst_aml_v4l2_video_dec_standby_discard(self);
+    gst_aml_v4l2_video_dec_standby_schedule(self);
+    g_mutex_unlock(&self->standby_lock);
+
+    GST_VIDEO_DECODER_STREAM_UNLOCK(self);
+}
+
+/* The standby output was configured from the hint, not from the caps that
+ * arrive later: the hint may be looser than them. Only swap it in when
+ * everything S_FMT and the OUTPUT buffer size were derived from is the
+ * same */
+static gboolean
+gst_aml_v4l2_video_dec_standby_fits(GstCaps *hint, GstCaps *caps)
+{
+    static const gchar *fields[] = {"width", "height", "format", "stream-format", "alignment",
+                                    "mpegversion", "wmvversion", "variant"};
+    GstStructure *hs, *cs;
+    guint i;
+
+    if (!hint || gst_caps_is_empty(hint) || gst_caps_is_empty(caps))
+        return FALSE;
+
+    hs = gst_caps_get_structure(hint, 0);
+    cs = gst_caps_get_structure(caps, 0);
+    if (!gst_structure_has_name(cs, gst_structure_get_name(hs)))
+        return FALSE;
+
+    /* the OUTPUT buffer size comes from the size */
+    if (!gst_structure_has_field(hs, "width") || !gst_structure_has_field(hs, "height"))
+        return FALSE;
+
+    for (i = 0; i < G_N_ELEMENTS(fields); i++)
+    {
+        const GValue *hv = gst_structure_get_value(hs, fields[i]);
+        const GValue *cv = gst_structure_get_value(cs, fields[i]);
+
+        if (!hv && !cv)
+            continue;
+        if (!hv || !cv || gst_value_compare(hv, cv) != GST_VALUE_EQUAL)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* A context still being prepared is not waited for. Called with the
+ * stream lock, which keeps a match valid until standby_swap() */
+static gboolean
+gst_aml_v4l2_video_dec_standby_match(GstAmlV4l2VideoDec *self, GstVideoCodecState *state)
+{
+    gboolean ret;
+
+    g_mutex_lock(&self->standby_lock);
+    ret = self->standby_ready &&
+          self->standby_output->stream_mode == self->v4l2output->stream_mode &&
+          gst_aml_v4l2_video_dec_standby_fits(self->standby_caps, state->caps);
+    g_mutex_unlock(&self->standby_lock);
+
+    return ret;
+}
+
+/* Stops the current stream for a standby swap instead of draining it: the
+ * frames still in the decoder are dropped, the last picture pushed stays
+ * shown until the first one of the new stream */
+static void
+gst_aml_v4l2_video_dec_standby_cut(GstVideoDecoder *decoder)
+{
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
+    GList *frames, *l;
+
+    if (gst_aml_v4l2_video_dec_get_task_state(self) == GST_TASK_STARTED)
+    {
+        GST_VIDEO_DECODER_STREAM_UNLOCK(decoder);
+
+        gst_aml_v4l2_object_unlock(self->v4l2output);
+        gst_aml_v4l2_object_unlock(self->v4l2capture);
+        gst_aml_v4l2_video_dec_stop_task(self);
+        GST_VIDEO_DECODER_STREAM_LOCK(decoder);
+    }
+
+    frames = gst_video_decoder_get_frames(decoder);
+    GST_DEBUG_OBJECT(self, "dropping %u frames of the old stream", g_list_length(frames));
+    for (l = frames; l != NULL; l = l->next)
+        gst_video_decoder_release_frame(decoder, l->data);
+    g_list_free(frames);
+    gst_aml_v4l2_video_dec_heap_clear(self);
+}
+
+/* Called with both current objects stopped, after standby_match() under the
+ * same stream lock. Takes @output_pool and @capture_pool, the pools of the
+ * current objects, which are freed along with the last of them */
+static void
+gst_aml_v4l2_video_dec_standby_swap(GstAmlV4l2VideoDec *self, GstBufferPool *output_pool,
+                                    GstBufferPool *capture_pool)
+{
+    GstBufferPool *pools[2] = {output_pool, capture_pool};
+    GstAmlV4l2VideoDecRetired *retired;
+    GstAmlV4l2Object *capture;
+    guint i;
+
+    g_mutex_lock(&self->standby_lock);
+
+    GST_DEBUG_OBJECT(self, "swapping in the standby context");
+
+    capture = self->standby_capture;
+
+    /* framerate and par of the new caps event went to the old object */
+    capture->fps = self->v4l2capture->fps;
+    self->v4l2capture->fps = NULL;
+    if (!capture->have_set_par)
+    {
+        capture->par = self->v4l2capture->par;
+        self->v4l2capture->par = NULL;
+    }
+
+    gst_aml_v4l2_object_close(self->v4l2output);
+    gst_aml_v4l2_object_close(self->v4l2capture);
+
+    /* one reference is ours, one per old pool */
+    retired = g_new0(GstAmlV4l2VideoDecRetired, 1);
+    retired->refs = 1;
+    retired->output = self->v4l2output;
+    retired->capture = self->v4l2capture;
+    for (i = 0; i < G_N_ELEMENTS(pools); i++)
+    {
+        if (!pools[i])
+            continue;
+        g_atomic_int_inc(&retired->refs);
+        gst_aml_v4l2_buffer_pool_set_free_notify(GST_AML_V4L2_BUFFER_POOL(pools[i]),
+                                                 gst_aml_v4l2_video_dec_retired_unref, retired);
+        gst_object_unref(pools[i]);
+    }
+
+    self->v4l2output = self->standby_output;
+    self->v4l2capture = capture;
+    self->standby_output = NULL;
+    self->standby_capture = NULL;
+    self->standby_ready = FALSE;
+
+    gst_caps_replace(&self->probed_srccaps, NULL);
+    self->probed_srccaps = self->standby_srccaps;
+    self->standby_srccaps = NULL;
+
+    /* the hint is consumed */
+    gst_caps_replace(&self->standby_caps, NULL);
+
+    g_mutex_unlock(&self->standby_lock);
+
+    gst_aml_v4l2_video_dec_retired_unref(retired);
+}
+
+static gboolean
+gst_aml_v4l2_video_dec_set_format(GstVideoDecoder *decoder,
+                                  GstVideoCodecState *state)
+{
+    GstAmlV4l2Error error = GST_AML_V4L2_ERROR_INIT;
+    gboolean ret = TRUE;
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
+    GstCaps *caps;
+    guint i;
+
+    GST_DEBUG_OBJECT(self, "Setting format: %" GST_PTR_FORMAT, state->caps);
+    if (self->input_state)
+    {
+        if (gst_aml_v4l2_video_dec_res_chg(decoder,state) || gst_aml_v4l2_video_dec_codec_chg(decoder,state))
+            GST_DEBUG_OBJECT(self, "resolution or codec changed");
+        else
+            goto done;
+
+        if (!gst_aml_v4l2_video_dec_codec_chg(decoder, state) &&
+            gst_aml_v4l2_video_dec_inband_res_chg(self, state))
+        {
+            GST_DEBUG_OBJECT(self, "resolution change signalled in-band, keep decoding");
+
+            /* a new codec_data is sent ahead of the next frame */
+            if (state->codec_data != self->input_state->codec_data)
+                self->codec_data_inject = FALSE;
+
+            gst_video_codec_state_unref(self->input_state);
+            self->input_state = gst_video_codec_state_ref(state);
+            gst_aml_v4l2_timestamp_set_framerate(&self->ts, GST_VIDEO_INFO_FPS_N(&state->info),
+                                                 GST_VIDEO_INFO_FPS_D(&state->info));
+            goto done;
+        }
+    }
+
+    GstCapsFeatures *const features = gst_caps_get_features(state->caps, 0);
+    GstStructure *s = gst_caps_get_structure(state->caps,0);
+    if (s && gst_structure_has_field(s,"format"))
+    {
+        if (!strcmp("XVID",gst_structure_get_string(s,"format")))
+        {
+            GST_DEBUG_OBJECT(self, "This is a DIVX file, cannot support");
+            ret = FALSE;
+            goto done;
+        }
+    }
+
+    if (gst_caps_features_contains(features, GST_CAPS_FEATURE_MEMORY_DMABUF))
+        self->v4l2output->req_mode = GST_V4L2_IO_DMABUF_IMPORT;
+
+    if (self->input_state)
+    {
+        GstBufferPool *output_pool = NULL, *capture_pool = NULL;
+        gboolean use_standby;
+
+        if (gst_aml_v4l2_object_caps_equal(self->v4l2output, state->caps))
+        {
+            GST_DEBUG_OBJECT(self, "Compatible caps");
+            goto done;
+        }
+        gst_video_codec_state_unref(self->input_state);
+        self->input_state = NULL;
+
+        use_standby = gst_aml_v4l2_video_dec_standby_match(self, state);
+        if (use_standby)
+        {
+            /* the old objects go along with their pools */
+            if (self->v4l2output->pool)
+                output_pool = gst_object_ref(self->v4l2output->pool);
+            if (self->v4l2capture->pool)
+                capture_pool = gst_object_ref(self->v4l2capture->pool);
+            gst_aml_v4l2_video_dec_standby_cut(decoder);
+        }
+        else
+            gst_aml_v4l2_video_dec_finish(decoder);
+        gst_aml_v4l2_object_stop(self->v4l2output);
+
+        /* Imported capture buffers (DMABUF_IMPORT, USERPTR) can always be
+         * orphaned: the old pool and allocator live on until downstream returns
+         * the last frame while a new pool starts right away.
+         *
+         * The renegotiation flow don't blend with the base class flow. To properly
+         * stop the capture pool, if the buffers can't be orphaned, we need to
+         * reclaim our buffers, which will happend through the allocation query.
+         * The allocation query is triggered by gst_video_decoder_negotiate() which
+         * requires the output caps to be set, but we can't know this information
+         * as we rely on the decoder, which requires the capture queue to be
+         * stopped.
+         *
+         * To workaround this issue, we simply run an allocation query with the
+         * old negotiated caps in order to drain/reclaim our buffers. That breaks
+         * the complexity and should not have much impact in performance since the
+         * following allocation query will happen on a drained pipeline and won't
+         * block. */
+        if (self->v4l2capture->pool &&
+            !gst_aml_v4l2_buffer_pool_orphan(&self->v4l2capture->pool))
+        {
+            GstCaps *caps = gst_pad_get_current_caps(decoder->srcpad);
+            if (caps)
+            {
+                GstQuery *query = gst_query_new_allocation(caps, FALSE);
+                gst_pad_peer_query(decoder->srcpad, query);
+                gst_query_unref(query);
+                gst_caps_unref(caps);
+            }
+        }
+
+        gst_aml_v4l2_object_stop(self->v4l2capture);
+        self->output_flow = GST_FLOW_OK;
+
+        gst_caps_replace(&self->predicted_caps, NULL);
+        g_atomic_int_set(&self->header_parsed, FALSE);
+
+        if (use_standby)
+        {
+            gst_aml_v4l2_video_dec_standby_swap(self, output_pool, capture_pool);
+            self->input_state = gst_video_codec_state_ref(state);
+            gst_aml_v4l2_timestamp_set_framerate(&self->ts, GST_VIDEO_INFO_FPS_N(&state->info),
+                                                 GST_VIDEO_INFO_FPS_D(&state->info));
+            goto done;
+        }
+    }
+
+    if ((ret = gst_aml_v4l2_set_drm_mode(self->v4l2output)) == FALSE)
+    {
+        GST_ERROR_OBJECT(self, "config output drm mode error");
+        goto done;
+    }
+
+    if ((ret = gst_aml_v4l2_set_stream_mode(self->v4l2output)) == FALSE)
+    {
+        GST_ERROR_OBJECT(self, "config output stream mode error");
+        goto done;
+    }
+
+    ret = gst_aml_v4l2_object_set_format(self->v4l2output, state->caps, &error);
+
+    if (self->fast_start && !self->probed_srccaps)
+    {
+        /* First configuration, the src template already carries the raw
+         * formats enumerated at register time. It lists their DMABUF copies
+         * first, only the system memory ones are taken so the order below
+         * stays the probe one. The full probe is done on the next
+         * renegotiation. */
+        GstCaps *templ = gst_pad_get_pad_template_caps(decoder->srcpad);
+
+        GST_DEBUG_OBJECT(self, "fast start, use src template caps");
+        self->probed_srccaps = gst_caps_new_empty();
+        for (i = 0; i < gst_caps_get_size(templ); i++)
+        {
+            GstCapsFeatures *features = gst_caps_get_features(templ, i);
+
+            if (features && gst_caps_features_contains(features, GST_CAPS_FEATURE_MEMORY_DMABUF))
+                continue;
+            gst_caps_append_structure(self->probed_srccaps,
+                                      gst_structure_copy(gst_caps_get_structure(templ, i)));
+        }
+        gst_caps_unref(templ);
+    }
+    else
+    {
+        gst_caps_replace(&self->probed_srccaps, NULL);
+        self->probed_srccaps = gst_aml_v4l2_object_probe_caps(self->v4l2capture,
+                                                              gst_aml_v4l2_object_get_raw_caps());
+    }
+
+    if (gst_caps_is_empty(self->probed_srccaps))
+        goto no_raw_format;
+
+    caps = gst_caps_copy(self->probed_srccaps);
+    gst_caps_set_features_simple(caps, gst_caps_features_from_string(GST_CAPS_FEATURE_MEMORY_DMABUF));
+    gst_caps_append(self->probed_srccaps, caps);
+    if (ret)
+    {
+        self->input_state = gst_video_codec_state_ref(state);
+        gst_aml_v4l2_timestamp_set_framerate(&self->ts, GST_VIDEO_INFO_FPS_N(&state->info),
+                                             GST_VIDEO_INFO_FPS_D(&state->info));
+
+        g_mutex_lock(&self->standby_lock);
+        gst_aml_v4l2_video_dec_standby_schedule(self);
+        g_mutex_unlock(&self->standby_lock);
+    }
+    else
+        gst_aml_v4l2_error(self, &error);
+
+done:
+    return ret;
+
+no_raw_format:
+    GST_ELEMENT_ERROR(self, RESOURCE, SETTINGS,
+                      (_("Decoder on device %s has no supported output format"),
+                       self->v4l2output->videodev),
+                      (NULL));
+    return GST_FLOW_ERROR;
+}
+
+static gboolean
+gst_aml_v4l2_video_dec_flush(GstVideoDecoder *decoder)
+{
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
+
+    GST_DEBUG_OBJECT(self, "Flushed");
+
+    /* Ensure the processing thread has stopped for the reverse playback
+     * discount case */
+    if (gst_aml_v4l2_video_dec_get_task_state(self) == GST_TASK_STARTED)
+    {
+        GST_VIDEO_DECODER_STREAM_UNLOCK(decoder);
+
+        gst_aml_v4l2_object_unlock(self->v4l2output);
+        gst_aml_v4l2_object_unlock(self->v4l2capture);
+        gst_aml_v4l2_video_dec_stop_task(self);
+        GST_VIDEO_DECODER_STREAM_LOCK(decoder);
+    }
+
+    self->output_flow = GST_FLOW_OK;
+    gst_aml_v4l2_video_dec_heap_clear(self);
+    self->thumbnail_count = 0;
+    self->thumbnail_last = GST_CLOCK_TIME_NONE;
+    self->error_burst = 0;
+    g_atomic_int_set(&self->resync_pending, FALSE);
+    gst_buffer_replace(&self->last_good, NULL);
+
+    gst_aml_v4l2_object_unlock_stop(self->v4l2output);
+    gst_aml_v4l2_object_unlock_stop(self->v4l2capture);
+
+    if (self->v4l2output->pool)
+        gst_aml_v4l2_buffer_pool_flush(self->v4l2output->pool);
+
+    /* gst_aml_v4l2_buffer_pool_flush() calls streamon the capture pool and must be
+     * called after gst_aml_v4l2_object_unlock_stop() stopped flushing the buffer
+     * pool. */
+    if (self->v4l2capture->pool)
+        gst_aml_v4l2_buffer_pool_flush(self->v4l2capture->pool);
+
+    return TRUE;
+}
+
+static gboolean
+gst_aml_v4l2_video_dec_negotiate(GstVideoDecoder *decoder)
+{
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
+
+    if (TRUE == self->v4l2output->is_svp)
+    {
+        GstStructure *s;
+        GstEvent *event;
 
         s = gst_structure_new_empty ("IS_SVP");
         event = gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM_STICKY, s);
@@ -578,269 +1406,1043 @@ gst_aml_v4l2_video_dec_negotiate(GstVideoDecoder *decoder)
         GST_DEBUG_OBJECT(self, "after Send SVP Event :%p", event);
     }
 
-    /* We don't allow renegotiation without carefull disabling the pool */
-    if (self->v4l2capture->pool &&
-        gst_buffer_pool_is_active(GST_BUFFER_POOL(self->v4l2capture->pool)))
-        return TRUE;
+    /* We don't allow renegotiation without carefull disabling the pool */
+    if (self->v4l2capture->pool &&
+        gst_buffer_pool_is_active(GST_BUFFER_POOL(self->v4l2capture->pool)))
+        return TRUE;
+
+    return GST_VIDEO_DECODER_CLASS(parent_class)->negotiate(decoder);
+}
+
+static gboolean
+gst_aml_v4l2_decoder_cmd(GstAmlV4l2Object *v4l2object, guint cmd, guint flags)
+{
+    struct v4l2_decoder_cmd dcmd = {
+        0,
+    };
+
+    GST_DEBUG_OBJECT(v4l2object->element,
+                     "sending v4l2 decoder command %u with flags %u", cmd, flags);
+
+    if (!GST_AML_V4L2_IS_OPEN(v4l2object))
+        return FALSE;
+
+    dcmd.cmd = cmd;
+    dcmd.flags = flags;
+    if (v4l2object->ioctl(v4l2object->video_fd, VIDIOC_DECODER_CMD, &dcmd) < 0)
+        goto dcmd_failed;
+
+    return TRUE;
+
+dcmd_failed:
+    if (errno == ENOTTY)
+    {
+        GST_INFO_OBJECT(v4l2object->element,
+                        "Failed to send decoder command %u with flags %u for '%s'. (%s)",
+                        cmd, flags, v4l2object->videodev, g_strerror(errno));
+    }
+    else
+    {
+        GST_ERROR_OBJECT(v4l2object->element,
+                         "Failed to send decoder command %u with flags %u for '%s'. (%s)",
+                         cmd, flags, v4l2object->videodev, g_strerror(errno));
+    }
+    return FALSE;
+}
+
+static GstFlowReturn
+gst_aml_v4l2_video_dec_finish(GstVideoDecoder *decoder)
+{
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
+    GstFlowReturn ret = GST_FLOW_OK;
+    GstBuffer *buffer;
+
+    if (gst_aml_v4l2_video_dec_get_task_state(self) != GST_TASK_STARTED)
+        goto done;
+
+    GST_DEBUG_OBJECT(self, "Finishing decoding");
+
+    GST_VIDEO_DECODER_STREAM_UNLOCK(decoder);
+
+    if (gst_aml_v4l2_decoder_cmd(self->v4l2output, V4L2_DEC_CMD_STOP, 0))
+    {
+        /* If the decoder stop command succeeded, just wait until processing is
+         * finished */
+        GST_DEBUG_OBJECT(self, "Waiting for decoder stop");
+        gst_aml_v4l2_video_dec_wait_task(self);
+        ret = GST_FLOW_FLUSHING;
+    }
+    else
+    {
+        /* otherwise keep queuing empty buffers until the processing thread has
+         * stopped, _pool_process() will return FLUSHING when that happened */
+        while (ret == GST_FLOW_OK)
+        {
+            GST_DEBUG_OBJECT(self, "queue empty output buf");
+            buffer = gst_buffer_new();
+            ret =
+                gst_aml_v4l2_buffer_pool_process(GST_AML_V4L2_BUFFER_POOL(self->v4l2output->pool), &buffer);
+            gst_buffer_unref(buffer);
+        }
+    }
+
+    /* and ensure the processing thread has stopped in case another error
+     * occured. */
+    gst_aml_v4l2_object_unlock(self->v4l2capture);
+    gst_aml_v4l2_video_dec_stop_task(self);
+    GST_VIDEO_DECODER_STREAM_LOCK(decoder);
+
+    if (ret == GST_FLOW_FLUSHING)
+        ret = self->output_flow;
+
+    GST_DEBUG_OBJECT(decoder, "Done draining buffers");
+
+    /* TODO Shall we cleanup any reffed frame to workaround broken decoders ? */
+
+done:
+    return ret;
+}
+
+static GstFlowReturn
+gst_aml_v4l2_video_dec_drain(GstVideoDecoder *decoder)
+{
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
+
+    GST_DEBUG_OBJECT(self, "Draining...");
+    gst_aml_v4l2_video_dec_finish(decoder);
+    gst_aml_v4l2_video_dec_flush(decoder);
+
+    return GST_FLOW_OK;
+}
+
+/* Pending frames are also kept in a binary min-heap ordered by timestamp
+ * (pts, or dts when pts is unknown), ties and untimestamped frames ordered by
+ * system_frame_number. The heap position is stored in the frame user data so
+ * a frame can be removed in O(log n) when it is finished, released or
+ * dropped. Like the base class frame list it is guarded by the stream lock:
+ * handle_frame drops that lock around queuing to the driver, so the capture
+ * thread never waits on a handle_frame blocked there. */
+#define FRAME_HEAP_INDEX(f) (GPOINTER_TO_UINT(gst_video_codec_frame_get_user_data(f)))
+#define FRAME_HEAP_SET_INDEX(f, i) gst_video_codec_frame_set_user_data(f, GUINT_TO_POINTER(i), NULL)
+
+static GstClockTime
+gst_aml_v4l2_video_dec_frame_ts(GstVideoCodecFrame *frame)
+{
+    return GST_CLOCK_TIME_IS_VALID(frame->pts) ? frame->pts : frame->dts;
+}
+
+static gboolean
+gst_aml_v4l2_video_dec_frame_older(GstVideoCodecFrame *a, GstVideoCodecFrame *b)
+{
+    GstClockTime ta = gst_aml_v4l2_video_dec_frame_ts(a);
+    GstClockTime tb = gst_aml_v4l2_video_dec_frame_ts(b);
+
+    /* GST_CLOCK_TIME_NONE is the largest value, untimestamped frames sort last */
+    if (ta != tb)
+        return ta < tb;
+    return a->system_frame_number < b->system_frame_number;
+}
+
+static void
+gst_aml_v4l2_video_dec_heap_swap(GPtrArray *heap, guint i, guint j)
+{
+    gpointer tmp = g_ptr_array_index(heap, i);
+
+    g_ptr_array_index(heap, i) = g_ptr_array_index(heap, j);
+    g_ptr_array_index(heap, j) = tmp;
+    FRAME_HEAP_SET_INDEX(g_ptr_array_index(heap, i), i + 1);
+    FRAME_HEAP_SET_INDEX(g_ptr_array_index(heap, j), j + 1);
+}
+
+static void
+gst_aml_v4l2_video_dec_heap_sift(GPtrArray *heap, guint i)
+{
+    while (i > 0 && gst_aml_v4l2_video_dec_frame_older(g_ptr_array_index(heap, i),
+                                                       g_ptr_array_index(heap, (i - 1) / 2)))
+    {
+        gst_aml_v4l2_video_dec_heap_swap(heap, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+
+    while (TRUE)
+    {
+        guint l = 2 * i + 1, r = l + 1, min = i;
+
+        if (l < heap->len && gst_aml_v4l2_video_dec_frame_older(g_ptr_array_index(heap, l),
+                                                                g_ptr_array_index(heap, min)))
+            min = l;
+        if (r < heap->len && gst_aml_v4l2_video_dec_frame_older(g_ptr_array_index(heap, r),
+                                                                g_ptr_array_index(heap, min)))
+            min = r;
+        if (min == i)
+            break;
+        gst_aml_v4l2_video_dec_heap_swap(heap, i, min);
+        i = min;
+    }
+}
+
+static void
+gst_aml_v4l2_video_dec_heap_push(GstAmlV4l2VideoDec *self, GstVideoCodecFrame *frame)
+{
+    GST_VIDEO_DECODER_STREAM_LOCK(self);
+    if (FRAME_HEAP_INDEX(frame) == 0)
+    {
+        g_ptr_array_add(self->frame_heap, gst_video_codec_frame_ref(frame));
+        FRAME_HEAP_SET_INDEX(frame, self->frame_heap->len);
+        gst_aml_v4l2_video_dec_heap_sift(self->frame_heap, self->frame_heap->len - 1);
+    }
+    GST_VIDEO_DECODER_STREAM_UNLOCK(self);
+}
+
+static void
+gst_aml_v4l2_video_dec_heap_remove(GstAmlV4l2VideoDec *self, GstVideoCodecFrame *frame)
+{
+    guint i, last;
+
+    GST_VIDEO_DECODER_STREAM_LOCK(self);
+    i = FRAME_HEAP_INDEX(frame);
+    if (i > 0 && i <= self->frame_heap->len && g_ptr_array_index(self->frame_heap, i - 1) == frame)
+    {
+        i--;
+        last = self->frame_heap->len - 1;
+        if (i != last)
+            gst_aml_v4l2_video_dec_heap_swap(self->frame_heap, i, last);
+        g_ptr_array_remove_index(self->frame_heap, last);
+        if (i < self->frame_heap->len)
+            gst_aml_v4l2_video_dec_heap_sift(self->frame_heap, i);
+        FRAME_HEAP_SET_INDEX(frame, 0);
+        gst_video_codec_frame_unref(frame);
+    }
+    GST_VIDEO_DECODER_STREAM_UNLOCK(self);
+}
+
+static void
+gst_aml_v4l2_video_dec_heap_clear(GstAmlV4l2VideoDec *self)
+{
+    guint i;
+
+    GST_VIDEO_DECODER_STREAM_LOCK(self);
+    for (i = 0; i < self->frame_heap->len; i++)
+    {
+        GstVideoCodecFrame *frame = g_ptr_array_index(self->frame_heap, i);
+
+        FRAME_HEAP_SET_INDEX(frame, 0);
+        gst_video_codec_frame_unref(frame);
+    }
+    g_ptr_array_set_size(self->frame_heap, 0);
+    GST_VIDEO_DECODER_STREAM_UNLOCK(self);
+}
+
+static GstVideoCodecFrame *
+gst_aml_v4l2_video_dec_get_oldest_frame(GstVideoDecoder *decoder)
+{
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
+    GstVideoCodecFrame *frame = NULL;
+
+    GST_VIDEO_DECODER_STREAM_LOCK(decoder);
+    if (self->frame_heap->len > 0)
+    {
+        frame = gst_video_codec_frame_ref(g_ptr_array_index(self->frame_heap, 0));
+        GST_LOG_OBJECT(decoder,
+                       "Oldest frame is %d %" GST_TIME_FORMAT " and %d frames left",
+                       frame->system_frame_number, GST_TIME_ARGS(frame->pts), self->frame_heap->len - 1);
+    }
+    GST_VIDEO_DECODER_STREAM_UNLOCK(decoder);
+
+    return frame;
+}
+
+static GstVideoCodecFrame *
+gst_aml_v4l2_video_dec_get_right_frame_for_frame_mode(GstVideoDecoder *decoder, GstClockTime pts)
+{
+    GstVideoCodecFrame *frame = NULL;
+    GList *frames, *l;
+    gint count = 0;
+
+    GST_LOG_OBJECT (decoder, "trace in with pts: %" GST_TIME_FORMAT, GST_TIME_ARGS(pts));
+
+    /* pictures come out in presentation order, the oldest pending frame
+     * normally is the one, no need to walk the list */
+    frame = gst_aml_v4l2_video_dec_get_oldest_frame(decoder);
+    if (frame && GST_CLOCK_TIME_IS_VALID(pts) && ABSDIFF(frame->pts, pts) < 1000)
+        return frame;
+    if (frame)
+    {
+        gst_video_codec_frame_unref(frame);
+        frame = NULL;
+    }
+
+    frames = gst_video_decoder_get_frames(decoder);
+
+    for (l = frames; l != NULL; l = l->next)
+    {
+        GstVideoCodecFrame *f = l->data;
+
+        if (GST_CLOCK_TIME_IS_VALID(pts) && (ABSDIFF(f->pts,pts)) < 1000) {
+            frame = f;
+        }
+        count++;
+    }
+
+    if (!frame)
+    {
+        for (l = frames; l != NULL; l = l->next)
+        {
+            GstVideoCodecFrame *f = l->data;
+            if (!GST_CLOCK_TIME_IS_VALID(f->pts))
+            {
+                frame = f;
+            }
+            GST_DEBUG("The pts of the expected output frame is invalid");
+        }
+    }
+
+    if (frame)
+    {
+        GST_LOG_OBJECT(decoder,
+                       "frame is %d %" GST_TIME_FORMAT " and %d frames left",
+                       frame->system_frame_number, GST_TIME_ARGS(frame->pts), count - 1);
+        gst_video_codec_frame_ref(frame);
+    }
+
+    g_list_free_full(frames, (GDestroyNotify)gst_video_codec_frame_unref);
+
+    GST_LOG_OBJECT (decoder, "trace out ret:%p", frame);
+    return frame;
+}
+
+static GstVideoCodecFrame *
+gst_aml_v4l2_video_dec_get_right_frame_for_stream_mode(GstVideoDecoder *decoder, GstClockTime pts)
+{
+    GstVideoCodecFrame *frame = NULL;
+    GList *frames, *l;
+    gint count = 0;
+
+    GST_LOG_OBJECT (decoder, "trace in with pts: %" GST_TIME_FORMAT, GST_TIME_ARGS(pts));
+
+    frames = gst_video_decoder_get_frames(decoder);
+    if (!frames)
+        return NULL;
+
+    guint frames_len = 0;
+    frames_len = g_list_length(frames);
+    GST_LOG_OBJECT (decoder, "got frames list len:%d", frames_len);
+
+    /* Walked in decode order: only the frames queued before the decoded one
+     * and older than it were skipped by the driver. Those queued after it may
+     * still come, B-frames have a smaller pts, so no pts ordered lookup */
+    for (l = frames; l != NULL; l = l->next)
+    {
+        GstVideoCodecFrame *f = l->data;
+
+        if (GST_CLOCK_TIME_IS_VALID(pts) && (ABSDIFF(f->pts, pts)) < 1000)
+        {
+            /* found the right frame */
+            frame = f;
+            break;
+        }
+        else if (GST_CLOCK_TIME_IS_VALID(pts) && GST_CLOCK_TIME_IS_VALID(f->pts) && f->pts < pts)
+        {
+            GST_LOG_OBJECT(decoder,
+                "stream mode drop frame %d %" GST_TIME_FORMAT,
+                f->system_frame_number, GST_TIME_ARGS(f->pts));
+
+            gst_video_codec_frame_ref(f);
+            gst_aml_v4l2_video_dec_heap_remove(GST_AML_V4L2_VIDEO_DEC(decoder), f);
+            gst_video_decoder_release_frame(decoder, f);
+        }
+        else if (!frame)
+        {
+            /* no match, the first frame still pending */
+            frame = f;
+        }
+    }
+
+    if (frame)
+    {
+        guint l_len = 0;
+        l = gst_video_decoder_get_frames(decoder);
+        l_len = g_list_length(l);
+        g_list_free_full(l, (GDestroyNotify)gst_video_codec_frame_unref);
+
+        GST_LOG_OBJECT(decoder,
+                       "frame is %d %" GST_TIME_FORMAT " and %d frames left",
+                       frame->system_frame_number, GST_TIME_ARGS(frame->pts), l_len);
+        gst_video_codec_frame_ref(frame);
+    }
+
+    g_list_free_full(frames, (GDestroyNotify)gst_video_codec_frame_unref);
 
-    return GST_VIDEO_DECODER_CLASS(parent_class)->negotiate(decoder);
+    GST_LOG_OBJECT (decoder, "trace out ret:%p", frame);
+    return frame;
 }
 
-static gboolean
-gst_aml_v4l2_decoder_cmd(GstAmlV4l2Object *v4l2object, guint cmd, guint flags)
+static GstVideoCodecFrame *
+gst_aml_v4l2_video_dec_get_right_frame_for_low_latency(GstVideoDecoder *decoder, GstClockTime pts)
 {
-    struct v4l2_decoder_cmd dcmd = {
-        0,
-    };
+    GstVideoCodecFrame *frame = NULL;
+    GList *frames, *l;
 
-    GST_DEBUG_OBJECT(v4l2object->element,
-                     "sending v4l2 decoder command %u with flags %u", cmd, flags);
+    GST_LOG_OBJECT (decoder, "trace in with pts: %" GST_TIME_FORMAT, GST_TIME_ARGS(pts));
 
-    if (!GST_AML_V4L2_IS_OPEN(v4l2object))
-        return FALSE;
+    frames = gst_video_decoder_get_frames(decoder);
 
-    dcmd.cmd = cmd;
-    dcmd.flags = flags;
-    if (v4l2object->ioctl(v4l2object->video_fd, VIDIOC_DECODER_CMD, &dcmd) < 0)
-        goto dcmd_failed;
+    /* The driver outputs in decode order, so the matching frame is normally
+     * the first pending one. Otherwise take the earliest submitted frame
+     * rather than waiting for a pts match. */
+    for (l = frames; l != NULL; l = l->next)
+    {
+        GstVideoCodecFrame *f = l->data;
 
-    return TRUE;
+        if (GST_CLOCK_TIME_IS_VALID(pts) && (ABSDIFF(f->pts, pts)) < 1000)
+        {
+            frame = f;
+            break;
+        }
+        if (!frame || f->system_frame_number < frame->system_frame_number)
+            frame = f;
+    }
 
-dcmd_failed:
-    if (errno == ENOTTY)
+    if (frame)
     {
-        GST_INFO_OBJECT(v4l2object->element,
-                        "Failed to send decoder command %u with flags %u for '%s'. (%s)",
-                        cmd, flags, v4l2object->videodev, g_strerror(errno));
+        GST_LOG_OBJECT(decoder, "frame is %d %" GST_TIME_FORMAT,
+                       frame->system_frame_number, GST_TIME_ARGS(frame->pts));
+        gst_video_codec_frame_ref(frame);
     }
+
+    g_list_free_full(frames, (GDestroyNotify)gst_video_codec_frame_unref);
+
+    return frame;
+}
+
+static GstVideoCodecFrame *
+gst_aml_v4l2_video_dec_get_right_frame(GstVideoDecoder *decoder, GstClockTime pts)
+{
+    GstAmlV4l2VideoDec *self = (GstAmlV4l2VideoDec *)decoder;
+    if (self->v4l2output->low_latency_mode || self->v4l2output->thumbnail_mode)
+        return gst_aml_v4l2_video_dec_get_right_frame_for_low_latency(decoder, pts);
+    else if (self->v4l2output->stream_mode)
+        return gst_aml_v4l2_video_dec_get_right_frame_for_stream_mode(decoder, pts);
     else
+        return gst_aml_v4l2_video_dec_get_right_frame_for_frame_mode(decoder, pts);
+}
+
+/* Preview items, events and buffers, go through a queue the preview pad
+ * task pushes from, so a blocked preview branch never holds the capture
+ * loop. It is leaky: a new buffer replaces those not pushed yet */
+static void
+gst_aml_v4l2_video_dec_preview_queue(GstAmlV4l2VideoDec *self, GstMiniObject *item)
+{
+    GList *l, *next;
+
+    g_mutex_lock(&self->preview_lock);
+    if (self->preview_flushing)
     {
-        GST_ERROR_OBJECT(v4l2object->element,
-                         "Failed to send decoder command %u with flags %u for '%s'. (%s)",
-                         cmd, flags, v4l2object->videodev, g_strerror(errno));
+        g_mutex_unlock(&self->preview_lock);
+        gst_mini_object_unref(item);
+        return;
     }
-    return FALSE;
+
+    if (GST_IS_BUFFER(item))
+    {
+        for (l = self->preview_queue.head; l != NULL; l = next)
+        {
+            next = l->next;
+            if (!GST_IS_BUFFER(l->data))
+                continue;
+            GST_LOG_OBJECT(self, "preview branch is late, dropping a picture");
+            gst_mini_object_unref(l->data);
+            g_queue_delete_link(&self->preview_queue, l);
+        }
+    }
+
+    g_queue_push_tail(&self->preview_queue, item);
+    g_cond_signal(&self->preview_cond);
+    g_mutex_unlock(&self->preview_lock);
 }
 
-static GstFlowReturn
-gst_aml_v4l2_video_dec_finish(GstVideoDecoder *decoder)
+static void
+gst_aml_v4l2_video_dec_preview_clear(GstAmlV4l2VideoDec *self)
 {
-    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
-    GstFlowReturn ret = GST_FLOW_OK;
-    GstBuffer *buffer;
+    GstMiniObject *item;
 
-    if (gst_pad_get_task_state(decoder->srcpad) != GST_TASK_STARTED)
-        goto done;
+    while ((item = g_queue_pop_head(&self->preview_queue)))
+        gst_mini_object_unref(item);
+}
 
-    GST_DEBUG_OBJECT(self, "Finishing decoding");
+/* Serialized events follow the queued pictures, a flush start goes out right
+ * away and drops them */
+static void
+gst_aml_v4l2_video_dec_preview_event(GstAmlV4l2VideoDec *self, GstEvent *event)
+{
+    GstPad *pad;
 
-    GST_VIDEO_DECODER_STREAM_UNLOCK(decoder);
+    GST_OBJECT_LOCK(self);
+    pad = self->preview_pad ? gst_object_ref(self->preview_pad) : NULL;
+    GST_OBJECT_UNLOCK(self);
 
-    if (gst_aml_v4l2_decoder_cmd(self->v4l2output, V4L2_DEC_CMD_STOP, 0))
+    if (!pad)
     {
-        GstTask *task = decoder->srcpad->task;
+        gst_event_unref(event);
+        return;
+    }
 
-        /* If the decoder stop command succeeded, just wait until processing is
-         * finished */
-        GST_DEBUG_OBJECT(self, "Waiting for decoder stop");
-        GST_OBJECT_LOCK(task);
-        while (GST_TASK_STATE(task) == GST_TASK_STARTED)
-            GST_TASK_WAIT(task);
-        GST_OBJECT_UNLOCK(task);
-        ret = GST_FLOW_FLUSHING;
+    if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_START)
+    {
+        g_mutex_lock(&self->preview_lock);
+        gst_aml_v4l2_video_dec_preview_clear(self);
+        g_mutex_unlock(&self->preview_lock);
+        gst_pad_push_event(pad, event);
     }
     else
     {
-        /* otherwise keep queuing empty buffers until the processing thread has
-         * stopped, _pool_process() will return FLUSHING when that happened */
-        while (ret == GST_FLOW_OK)
-        {
-            GST_DEBUG_OBJECT(self, "queue empty output buf");
-            buffer = gst_buffer_new();
-            ret =
-                gst_aml_v4l2_buffer_pool_process(GST_AML_V4L2_BUFFER_POOL(self->v4l2output->pool), &buffer);
-            gst_buffer_unref(buffer);
-        }
+        gst_aml_v4l2_video_dec_preview_queue(self, GST_MINI_OBJECT_CAST(event));
     }
 
-    /* and ensure the processing thread has stopped in case another error
-     * occured. */
-    gst_aml_v4l2_object_unlock(self->v4l2capture);
-    gst_pad_stop_task(decoder->srcpad);
-    GST_VIDEO_DECODER_STREAM_LOCK(decoder);
+    gst_object_unref(pad);
+}
 
-    if (ret == GST_FLOW_FLUSHING)
-        ret = self->output_flow;
+static void
+gst_aml_v4l2_video_dec_preview_loop(gpointer data)
+{
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(data);
+    GstMiniObject *item;
+    GstFlowReturn ret;
+    GstPad *pad;
 
-    GST_DEBUG_OBJECT(decoder, "Done draining buffers");
+    g_mutex_lock(&self->preview_lock);
+    while (g_queue_is_empty(&self->preview_queue) && !self->preview_flushing)
+        g_cond_wait(&self->preview_cond, &self->preview_lock);
+    item = g_queue_pop_head(&self->preview_queue);
+    g_mutex_unlock(&self->preview_lock);
 
-    /* TODO Shall we cleanup any reffed frame to workaround broken decoders ? */
+    if (!item)
+        return;
 
-done:
-    return ret;
+    GST_OBJECT_LOCK(self);
+    pad = self->preview_pad ? gst_object_ref(self->preview_pad) : NULL;
+    GST_OBJECT_UNLOCK(self);
+
+    if (!pad)
+    {
+        gst_mini_object_unref(item);
+        return;
+    }
+
+    if (GST_IS_BUFFER(item))
+    {
+        ret = gst_pad_push(pad, GST_BUFFER_CAST(item));
+        if (ret != GST_FLOW_OK)
+            GST_LOG_OBJECT(self, "preview push returned %s", gst_flow_get_name(ret));
+    }
+    else
+    {
+        gst_pad_push_event(pad, GST_EVENT_CAST(item));
+    }
+
+    gst_object_unref(pad);
 }
 
-static GstFlowReturn
-gst_aml_v4l2_video_dec_drain(GstVideoDecoder *decoder)
+static gboolean
+gst_aml_v4l2_video_dec_preview_activate_mode(GstPad *pad, GstObject *parent, GstPadMode mode,
+                                             gboolean active)
 {
-    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
+    /* also called from request_new_pad, before the pad has a parent */
+    GstAmlV4l2VideoDec *self = gst_pad_get_element_private(pad);
 
-    GST_DEBUG_OBJECT(self, "Draining...");
-    gst_aml_v4l2_video_dec_finish(decoder);
-    gst_aml_v4l2_video_dec_flush(decoder);
+    if (mode != GST_PAD_MODE_PUSH)
+        return FALSE;
 
-    return GST_FLOW_OK;
+    g_mutex_lock(&self->preview_lock);
+    self->preview_flushing = !active;
+    if (!active)
+        gst_aml_v4l2_video_dec_preview_clear(self);
+    g_cond_signal(&self->preview_cond);
+    g_mutex_unlock(&self->preview_lock);
+
+    if (active)
+        return gst_pad_start_task(pad, gst_aml_v4l2_video_dec_preview_loop, self, NULL);
+
+    return gst_pad_stop_task(pad);
 }
 
-static GstVideoCodecFrame *
-gst_aml_v4l2_video_dec_get_oldest_frame(GstVideoDecoder *decoder)
+/* A new buffer on the same dmabufs as the capture @buffer, laid out as @info,
+ * which it keeps alive with a parent meta: sharing the memories instead would
+ * let the pool queue @buffer back while still read. NULL if the memories
+ * aren't dmabufs */
+static GstBuffer *
+gst_aml_v4l2_video_dec_wrap_capture(GstAmlV4l2VideoDec *self, GstBuffer *buffer,
+                                    GstVideoInfo *info)
 {
-    GstVideoCodecFrame *frame = NULL;
-    GList *frames, *l;
-    gint count = 0;
+    GstBuffer *wrapped;
+    guint i;
 
-    frames = gst_video_decoder_get_frames(decoder);
+    wrapped = gst_buffer_new();
+    for (i = 0; i < gst_buffer_n_memory(buffer); i++)
+    {
+        GstMemory *mem = gst_buffer_peek_memory(buffer, i);
+        GstMemory *wrap;
+        gsize offset, maxsize, size;
+        gint fd;
+
+        if (!gst_is_dmabuf_memory(mem))
+            goto not_dmabuf;
+
+        size = gst_memory_get_sizes(mem, &offset, &maxsize);
+        fd = dup(gst_dmabuf_memory_get_fd(mem));
+        if (fd < 0)
+            goto dup_failed;
+
+        wrap = gst_dmabuf_allocator_alloc(self->dmabuf_allocator, fd, maxsize);
+        gst_memory_resize(wrap, offset, size);
+        GST_MINI_OBJECT_FLAG_SET(wrap, GST_MEMORY_FLAG_READONLY);
+        gst_buffer_append_memory(wrapped, wrap);
+    }
 
-    for (l = frames; l != NULL; l = l->next)
+    gst_buffer_copy_into(wrapped, buffer, GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+    gst_buffer_add_video_meta_full(wrapped, GST_VIDEO_FRAME_FLAG_NONE,
+                                   GST_VIDEO_INFO_FORMAT(info), GST_VIDEO_INFO_WIDTH(info),
+                                   GST_VIDEO_INFO_HEIGHT(info), GST_VIDEO_INFO_N_PLANES(info),
+                                   info->offset, info->stride);
+    gst_buffer_add_parent_buffer_meta(wrapped, buffer);
+
+    return wrapped;
+
+not_dmabuf:
+{
+    GST_DEBUG_OBJECT(self, "capture memory %u is not dmabuf", i);
+    gst_buffer_unref(wrapped);
+    return NULL;
+}
+dup_failed:
+{
+    GST_WARNING_OBJECT(self, "can't dup capture dmabuf: %s", g_strerror(errno));
+    gst_buffer_unref(wrapped);
+    return NULL;
+}
+}
+
+/* Downscale of the linear double-write picture from the main one, per
+ * dimension. 0 when the dw mode has no linear picture */
+static guint
+gst_aml_v4l2_video_dec_dw_ratio(gint dw_mode)
+{
+    switch (dw_mode)
     {
-        GstVideoCodecFrame *f = l->data;
+    case VDEC_DW_AFBC_1_1_DW:
+    case VDEC_DW_NO_AFBC:
+    case VDEC_DW_MMU_1:
+        return 1;
+    case VDEC_DW_AFBC_1_2_DW:
+    case VDEC_DW_MMU_1_2:
+    case VDEC_DW_AFBC_AUTO_1_2:
+        return 2;
+    case VDEC_DW_AFBC_1_4_DW:
+    case VDEC_DW_AFBC_x2_1_4_DW:
+    case VDEC_DW_MMU_1_4:
+    case VDEC_DW_AFBC_AUTO_1_4:
+        return 4;
+    default:
+        return 0;
+    }
+}
 
-        if (!frame || (GST_CLOCK_TIME_IS_VALID(frame->pts) && GST_CLOCK_TIME_IS_VALID(f->pts) && (frame->pts > f->pts)))
-            frame = f;
+/* The capture planes start with the linear double-write picture, downscaled
+ * from the main picture by the dw mode and packed at its own size. The
+ * preview wraps the same dmabufs. There is none when the dw picture is the
+ * main one, the src pad already carries it */
+static GstBuffer *
+gst_aml_v4l2_video_dec_preview_wrap(GstAmlV4l2VideoDec *self, GstBuffer *buffer)
+{
+    GstVideoInfo *info = &self->v4l2capture->info;
 
-        count++;
+    if (!self->preview_pad || self->is_secure_path)
+        return NULL;
+
+    if (!gst_video_info_is_equal(info, &self->preview_main_info))
+    {
+        gint dw_mode = gst_aml_v4l2_object_get_dw_mode(self->v4l2output);
+        guint ratio = gst_aml_v4l2_video_dec_dw_ratio(dw_mode);
+
+        self->preview_main_info = *info;
+        self->preview_disabled = (ratio <= 1);
+        if (ratio == 0)
+        {
+            GST_WARNING_OBJECT(self, "dw mode %d has no linear picture, no preview", dw_mode);
+        }
+        else if (ratio == 1)
+        {
+            GST_INFO_OBJECT(self, "dw mode %d picture is the main one, no preview", dw_mode);
+        }
+        else
+        {
+            GstVideoInfo *preview_info = &self->preview_info;
+
+            gst_video_info_set_format(preview_info, GST_VIDEO_INFO_FORMAT(info),
+                                      GST_VIDEO_INFO_WIDTH(info) / ratio,
+                                      GST_VIDEO_INFO_HEIGHT(info) / ratio);
+            GST_VIDEO_INFO_INTERLACE_MODE(preview_info) = GST_VIDEO_INFO_INTERLACE_MODE(info);
+            GST_VIDEO_INFO_PAR_N(preview_info) = GST_VIDEO_INFO_PAR_N(info);
+            GST_VIDEO_INFO_PAR_D(preview_info) = GST_VIDEO_INFO_PAR_D(info);
+            GST_VIDEO_INFO_FPS_N(preview_info) = GST_VIDEO_INFO_FPS_N(info);
+            GST_VIDEO_INFO_FPS_D(preview_info) = GST_VIDEO_INFO_FPS_D(info);
+            preview_info->colorimetry = info->colorimetry;
+
+            GST_DEBUG_OBJECT(self, "preview %dx%d with dw mode %d", GST_VIDEO_INFO_WIDTH(preview_info),
+                             GST_VIDEO_INFO_HEIGHT(preview_info), dw_mode);
+            self->preview_caps_pending = TRUE;
+        }
     }
 
-    if (frame)
+    if (!self->preview_disabled && !gst_is_dmabuf_memory(gst_buffer_peek_memory(buffer, 0)))
     {
-        GST_LOG_OBJECT(decoder,
-                       "Oldest frame is %d %" GST_TIME_FORMAT " and %d frames left",
-                       frame->system_frame_number, GST_TIME_ARGS(frame->pts), count - 1);
-        gst_video_codec_frame_ref(frame);
+        GST_WARNING_OBJECT(self, "capture memory is not dmabuf, no preview");
+        self->preview_disabled = TRUE;
     }
 
-    g_list_free_full(frames, (GDestroyNotify)gst_video_codec_frame_unref);
+    if (self->preview_disabled)
+        return NULL;
 
-    return frame;
+    return gst_aml_v4l2_video_dec_wrap_capture(self, buffer, &self->preview_info);
 }
 
-static GstVideoCodecFrame *
-gst_aml_v4l2_video_dec_get_right_frame_for_frame_mode(GstVideoDecoder *decoder, GstClockTime pts)
+static GstStructure *
+gst_aml_v4l2_video_dec_error_stats(GstAmlV4l2VideoDec *self)
 {
-    GstVideoCodecFrame *frame = NULL;
-    GList *frames, *l;
-    gint count = 0;
+    GstStructure *s;
 
-    GST_LOG_OBJECT (decoder, "trace in with pts: %" GST_TIME_FORMAT, GST_TIME_ARGS(pts));
+    GST_OBJECT_LOCK(self);
+    s = gst_structure_new("aml-v4l2-error-stats",
+                          "truncated", G_TYPE_UINT64, self->errors_truncated,
+                          "decode-errors", G_TYPE_UINT64, self->errors_decode,
+                          "concealed", G_TYPE_UINT64, self->errors_concealed,
+                          "repeated", G_TYPE_UINT64, self->errors_repeated,
+                          "dropped", G_TYPE_UINT64, self->errors_dropped,
+                          "resyncs", G_TYPE_UINT64, self->resyncs,
+                          "resync-discarded", G_TYPE_UINT64, self->resync_discarded,
+                          NULL);
+    GST_OBJECT_UNLOCK(self);
+
+    return s;
+}
 
-    frames = gst_video_decoder_get_frames(decoder);
+static GstAmlV4l2BufferPool *
+gst_aml_v4l2_video_dec_ref_capture_pool(GstAmlV4l2VideoDec *self)
+{
+    GstAmlV4l2BufferPool *pool = NULL;
 
-    for (l = frames; l != NULL; l = l->next)
+    GST_OBJECT_LOCK(self);
+    if (self->v4l2capture && self->v4l2capture->pool)
+        pool = gst_object_ref(GST_AML_V4L2_BUFFER_POOL(self->v4l2capture->pool));
+    GST_OBJECT_UNLOCK(self);
+
+    return pool;
+}
+
+static GstStructure *
+gst_aml_v4l2_video_dec_capture_pool_stat(GstAmlV4l2VideoDec *self)
+{
+    GstAmlV4l2BufferPool *pool = gst_aml_v4l2_video_dec_ref_capture_pool(self);
+    GstStructure *s;
+
+    if (!pool)
+        return NULL;
+
+    s = gst_aml_v4l2_buffer_pool_get_stat(pool);
+    gst_object_unref(pool);
+
+    return s;
+}
+
+/* "dump-pool-stat" action */
+static gboolean
+gst_aml_v4l2_video_dec_dump_pool_stat(GstAmlV4l2VideoDec *self)
+{
+    GstAmlV4l2BufferPool *pool = gst_aml_v4l2_video_dec_ref_capture_pool(self);
+    gboolean ret;
+
+    if (!pool)
+        return FALSE;
+
+    ret = gst_aml_v4l2_buffer_pool_dump_stat(pool);
+    gst_object_unref(pool);
+
+    return ret;
+}
+
+/* counts one more corrupted output, from the processing thread */
+static void
+gst_aml_v4l2_video_dec_error_burst(GstAmlV4l2VideoDec *self, guint64 *counter)
+{
+    GST_OBJECT_LOCK(self);
+    (*counter)++;
+    GST_OBJECT_UNLOCK(self);
+
+    if (!self->resync_threshold || ++self->error_burst < self->resync_threshold)
+        return;
+
+    /* the frames queued behind the error reference it, stop feeding them
+     * until the next keyframe */
+    if (!g_atomic_int_get(&self->resync_pending))
     {
-        GstVideoCodecFrame *f = l->data;
+        GST_WARNING_OBJECT(self, "%u corrupted frames in a row, waiting for a keyframe",
+                           self->error_burst);
+        GST_OBJECT_LOCK(self);
+        self->resyncs++;
+        GST_OBJECT_UNLOCK(self);
+        g_atomic_int_set(&self->resync_pending, TRUE);
+    }
+    self->error_burst = 0;
+}
 
-        if (GST_CLOCK_TIME_IS_VALID(pts) && (ABSDIFF(f->pts,pts)) < 1000) {
-            frame = f;
-        }
-        count++;
+/* Applies error-policy to the output of @frame. FALSE if the frame is to be
+ * dropped */
+static gboolean
+gst_aml_v4l2_video_dec_error_policy(GstAmlV4l2VideoDec *self, GstVideoCodecFrame *frame)
+{
+    GstBuffer *buffer = frame->output_buffer;
+    GstBuffer *repeat;
+
+    if (!GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_CORRUPTED))
+    {
+        self->error_burst = 0;
+        /* only referenced in repeat mode, it holds a capture buffer */
+        if (self->error_policy == GST_AML_V4L2_ERROR_REPEAT)
+            gst_buffer_replace(&self->last_good, buffer);
+        return TRUE;
     }
 
-    if (!frame)
+    gst_aml_v4l2_video_dec_error_burst(self, &self->errors_decode);
+
+    switch (self->error_policy)
     {
-        for (l = frames; l != NULL; l = l->next)
+    case GST_AML_V4L2_ERROR_REPEAT:
+        if (self->last_good && (repeat = gst_aml_v4l2_video_dec_wrap_capture(self, self->last_good,
+                                                                            &self->v4l2capture->info)))
         {
-            GstVideoCodecFrame *f = l->data;
-            if (!GST_CLOCK_TIME_IS_VALID(f->pts))
-            {
-                frame = f;
-            }
-            GST_DEBUG("The pts of the expected output frame is invalid");
+            GST_DEBUG_OBJECT(self, "frame %d corrupted, repeating the last good one",
+                             frame->system_frame_number);
+            gst_buffer_copy_into(repeat, buffer, GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+            gst_buffer_unref(frame->output_buffer);
+            frame->output_buffer = repeat;
+
+            GST_OBJECT_LOCK(self);
+            self->errors_repeated++;
+            GST_OBJECT_UNLOCK(self);
+            return TRUE;
         }
+        /* nothing to repeat yet */
+        /* fall through */
+    case GST_AML_V4L2_ERROR_CONCEAL:
+        GST_DEBUG_OBJECT(self, "frame %d corrupted, output concealed", frame->system_frame_number);
+        GST_OBJECT_LOCK(self);
+        self->errors_concealed++;
+        GST_OBJECT_UNLOCK(self);
+        return TRUE;
+    case GST_AML_V4L2_ERROR_DROP:
+    default:
+        GST_DEBUG_OBJECT(self, "frame %d corrupted, dropping", frame->system_frame_number);
+        GST_OBJECT_LOCK(self);
+        self->errors_dropped++;
+        GST_OBJECT_UNLOCK(self);
+        return FALSE;
+    }
+}
+
+/* Queues @preview for the preview pad task with the events it needs first.
+ * The preview pad never stops decoding, its flow return is only logged */
+static void
+gst_aml_v4l2_video_dec_push_preview(GstAmlV4l2VideoDec *self, GstBuffer *preview)
+{
+    GstVideoDecoder *decoder = GST_VIDEO_DECODER(self);
+    GstSegment segment;
+    GstPad *pad;
+
+    GST_OBJECT_LOCK(self);
+    pad = self->preview_pad ? gst_object_ref(self->preview_pad) : NULL;
+    GST_OBJECT_UNLOCK(self);
+
+    if (!pad)
+    {
+        gst_buffer_unref(preview);
+        return;
+    }
+
+    if (!self->preview_started)
+    {
+        gchar *stream_id = gst_pad_create_stream_id(pad, GST_ELEMENT(self), "preview");
+
+        gst_aml_v4l2_video_dec_preview_event(self, gst_event_new_stream_start(stream_id));
+        g_free(stream_id);
+        self->preview_started = TRUE;
+        self->preview_caps_pending = TRUE;
+    }
+
+    if (self->preview_caps_pending)
+    {
+        GstCaps *caps = gst_video_info_to_caps(&self->preview_info);
+
+        GST_DEBUG_OBJECT(self, "preview caps %" GST_PTR_FORMAT, caps);
+        gst_aml_v4l2_video_dec_preview_event(self, gst_event_new_caps(caps));
+        gst_caps_unref(caps);
+        self->preview_caps_pending = FALSE;
     }
 
-    if (frame)
+    /* follows the segment the base class last pushed on the srcpad */
+    GST_VIDEO_DECODER_STREAM_LOCK(decoder);
+    segment = decoder->output_segment;
+    GST_VIDEO_DECODER_STREAM_UNLOCK(decoder);
+    if (!gst_segment_is_equal(&segment, &self->preview_segment))
     {
-        GST_LOG_OBJECT(decoder,
-                       "frame is %d %" GST_TIME_FORMAT " and %d frames left",
-                       frame->system_frame_number, GST_TIME_ARGS(frame->pts), count - 1);
-        gst_video_codec_frame_ref(frame);
+        gst_aml_v4l2_video_dec_preview_event(self, gst_event_new_segment(&segment));
+        self->preview_segment = segment;
     }
 
-    g_list_free_full(frames, (GDestroyNotify)gst_video_codec_frame_unref);
+    gst_aml_v4l2_video_dec_preview_queue(self, GST_MINI_OBJECT_CAST(preview));
 
-    GST_LOG_OBJECT (decoder, "trace out ret:%p", frame);
-    return frame;
+    gst_object_unref(pad);
 }
 
-static GstVideoCodecFrame *
-gst_aml_v4l2_video_dec_get_right_frame_for_stream_mode(GstVideoDecoder *decoder, GstClockTime pts)
+static GstStructure *
+gst_aml_v4l2_video_dec_decode_stats(GstAmlV4l2VideoDec *self)
 {
-    GstVideoCodecFrame *frame = NULL;
-    GList *frames, *l;
-    gint count = 0;
+    GstStructure *s;
+    GstClockTime elapsed = 0;
+
+    GST_OBJECT_LOCK(self);
+    if (GST_CLOCK_TIME_IS_VALID(self->decode_start) && GST_CLOCK_TIME_IS_VALID(self->decode_last))
+        elapsed = self->decode_last - self->decode_start;
+
+    s = gst_structure_new("aml-v4l2-decode-stats",
+                          "frames", G_TYPE_UINT64, self->decoded_frames,
+                          "corrupted", G_TYPE_UINT64, self->decoded_corrupted,
+                          "elapsed", G_TYPE_UINT64, elapsed,
+                          "fps", G_TYPE_DOUBLE, elapsed ? (gdouble)self->decoded_frames * GST_SECOND / elapsed : 0.0,
+                          "width", G_TYPE_INT, GST_VIDEO_INFO_WIDTH(&self->v4l2capture->info),
+                          "height", G_TYPE_INT, GST_VIDEO_INFO_HEIGHT(&self->v4l2capture->info),
+                          NULL);
+    if (self->decoded_checksum)
+        gst_structure_set(s, "checksum", G_TYPE_STRING, g_checksum_get_string(self->decoded_checksum), NULL);
+    GST_OBJECT_UNLOCK(self);
+
+    return s;
+}
 
-    GST_LOG_OBJECT (decoder, "trace in with pts: %" GST_TIME_FORMAT, GST_TIME_ARGS(pts));
+/* decode-only allocation: our own capture pool, configured as for a peer
+ * that supports video meta and proposes nothing */
+static gboolean
+gst_aml_v4l2_video_dec_null_allocation(GstAmlV4l2VideoDec *self, GstVideoInfo *info)
+{
+    GstCaps *caps = gst_video_info_to_caps(info);
+    GstQuery *query = gst_query_new_allocation(caps, TRUE);
+    gboolean ret;
 
-    frames = gst_video_decoder_get_frames(decoder);
-    guint frames_len = 0;
-    frames_len = g_list_length(frames);
-    GST_LOG_OBJECT (decoder, "got frames list len:%d", frames_len);
+    gst_query_add_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL);
+    ret = gst_aml_v4l2_object_decide_allocation(self->v4l2capture, query);
 
-    frame = frames->data;
+    gst_query_unref(query);
+    gst_caps_unref(caps);
 
-    for (l = frames; l != NULL; l = l->next)
-    {
-        GstVideoCodecFrame *f = l->data;
+    return ret;
+}
 
-        if (GST_CLOCK_TIME_IS_VALID(pts) && (ABSDIFF(f->pts, pts)) < 1000)
-        {
-            /* found the right frame */
-            frame = f;
-            break;
-        }
-        else if(GST_CLOCK_TIME_IS_VALID(pts) && (f->pts < pts))
-        {
-            GST_LOG_OBJECT(decoder,
-                "stream mode drop frame %d %" GST_TIME_FORMAT,
-                frame->system_frame_number, GST_TIME_ARGS(frame->pts));
+static void
+gst_aml_v4l2_video_dec_null_capture(GstAmlV4l2VideoDec *self, GstBuffer *buffer)
+{
+    GstVideoFrame frame;
+    guint plane, comp;
+    gint row;
 
-            gst_video_codec_frame_ref(f);
-            // gst_video_decoder_drop_frame(decoder, f);
-            gst_video_decoder_release_frame(decoder, f);
-        }
-        else
+    /* the checksum covers the visible pixels only, not the padding */
+    if (self->decode_checksum &&
+        gst_video_frame_map(&frame, &self->v4l2capture->info, buffer, GST_MAP_READ))
+    {
+        GST_OBJECT_LOCK(self);
+        if (!self->decoded_checksum)
+            self->decoded_checksum = g_checksum_new(G_CHECKSUM_MD5);
+        for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES(&frame); plane++)
         {
-            GST_LOG_OBJECT (decoder, "dbg");
+            const guint8 *data = GST_VIDEO_FRAME_PLANE_DATA(&frame, plane);
+            gint stride = GST_VIDEO_FRAME_PLANE_STRIDE(&frame, plane);
+
+            for (comp = 0; GST_VIDEO_FRAME_COMP_PLANE(&frame, comp) != plane; comp++)
+                ;
+            for (row = 0; row < GST_VIDEO_FRAME_COMP_HEIGHT(&frame, comp); row++)
+                g_checksum_update(self->decoded_checksum, data + row * stride,
+                                  GST_VIDEO_FRAME_COMP_WIDTH(&frame, comp) *
+                                      GST_VIDEO_FRAME_COMP_PSTRIDE(&frame, comp));
         }
+        GST_OBJECT_UNLOCK(self);
+        gst_video_frame_unmap(&frame);
     }
 
-    if (frame)
-    {
-        guint l_len = 0;
-        l = gst_video_decoder_get_frames(decoder);
-        l_len = g_list_length(l);
-        g_list_free_full(l, (GDestroyNotify)gst_video_codec_frame_unref);
+    GST_OBJECT_LOCK(self);
+    self->decoded_frames++;
+    self->decode_last = gst_util_get_timestamp();
+    GST_OBJECT_UNLOCK(self);
 
-        GST_LOG_OBJECT(decoder,
-                       "frame is %d %" GST_TIME_FORMAT " and %d frames left",
-                       frame->system_frame_number, GST_TIME_ARGS(frame->pts), l_len);
-        gst_video_codec_frame_ref(frame);
-    }
+    GST_LOG_OBJECT(self, "decode-only, requeue buffer %p pts %" GST_TIME_FORMAT,
+                   buffer, GST_TIME_ARGS(GST_BUFFER_PTS(buffer)));
 
-    g_list_free_full(frames, (GDestroyNotify)gst_video_codec_frame_unref);
+    /* back to the pool, which queues it to the driver right away */
+    gst_buffer_unref(buffer);
+}
 
-    GST_LOG_OBJECT (decoder, "trace out ret:%p", frame);
-    return frame;
+static GstPad *
+gst_aml_v4l2_video_dec_request_new_pad(GstElement *element, GstPadTemplate *templ,
+                                       const gchar *name, const GstCaps *caps)
+{
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(element);
+    GstPad *pad;
+
+    GST_OBJECT_LOCK(self);
+    if (self->preview_pad)
+    {
+        GST_OBJECT_UNLOCK(self);
+        GST_WARNING_OBJECT(self, "preview pad already requested");
+        return NULL;
+    }
+
+    pad = gst_pad_new_from_template(templ, "preview");
+    gst_pad_use_fixed_caps(pad);
+    gst_pad_set_element_private(pad, self);
+    gst_pad_set_activatemode_function(pad, gst_aml_v4l2_video_dec_preview_activate_mode);
+    self->preview_pad = gst_object_ref(pad);
+    self->preview_started = FALSE;
+    self->preview_disabled = FALSE;
+    gst_video_info_init(&self->preview_info);
+    gst_video_info_init(&self->preview_main_info);
+    gst_segment_init(&self->preview_segment, GST_FORMAT_UNDEFINED);
+    GST_OBJECT_UNLOCK(self);
+
+    gst_pad_set_active(pad, TRUE);
+    gst_element_add_pad(element, pad);
+
+    return pad;
 }
 
-static GstVideoCodecFrame *
-gst_aml_v4l2_video_dec_get_right_frame(GstVideoDecoder *decoder, GstClockTime pts)
+static void
+gst_aml_v4l2_video_dec_release_pad(GstElement *element, GstPad *pad)
 {
-    GstAmlV4l2VideoDec *self = (GstAmlV4l2VideoDec *)decoder;
-    if (self->v4l2output->stream_mode)
-        return gst_aml_v4l2_video_dec_get_right_frame_for_stream_mode(decoder, pts);
-    else
-        return gst_aml_v4l2_video_dec_get_right_frame_for_frame_mode(decoder, pts);
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(element);
+
+    GST_OBJECT_LOCK(self);
+    if (pad != self->preview_pad)
+    {
+        GST_OBJECT_UNLOCK(self);
+        return;
+    }
+    GST_OBJECT_UNLOCK(self);
+
+    /* stops the preview task first, it looks the pad up */
+    gst_pad_set_active(pad, FALSE);
+
+    GST_OBJECT_LOCK(self);
+    self->preview_pad = NULL;
+    GST_OBJECT_UNLOCK(self);
+
+    gst_element_remove_pad(element, pad);
+    gst_object_unref(pad);
 }
 
 static gboolean
@@ -878,35 +2480,6 @@ gst_aml_v4l2_video_remove_padding(GstCapsFeatures *features,
     return TRUE;
 }
 
-static void
-gst_v4l2_drop_event (GstAmlV4l2Object * v4l2object)
-{
-  struct v4l2_event evt;
-  gint ret;
-
-  memset (&evt, 0x00, sizeof (struct v4l2_event));
-  ret = v4l2object->ioctl (v4l2object->video_fd, VIDIOC_DQEVENT, &evt);
-  if (ret < 0)
-  {
-    GST_DEBUG_OBJECT (v4l2object, "dqevent failed");
-    return;
-  }
-
-  switch (evt.type)
-  {
-    case V4L2_EVENT_SOURCE_CHANGE:
-      GST_DEBUG_OBJECT (v4l2object, "Drop GST_V4L2_FLOW_SOURCE_CHANGE");
-      break;
-    case V4L2_EVENT_EOS:
-      GST_DEBUG_OBJECT (v4l2object, "Drop GST_V4L2_FLOW_LAST_BUFFER");
-      break;
-    default:
-      break;
-  }
-
-  return;
-}
-
 static void
 gst_aml_v4l2_video_dec_set_output_status(GstVideoDecoder *decoder,GstVideoInfo info)
 {
@@ -949,6 +2522,36 @@ gst_aml_v4l2_video_dec_set_output_status(GstVideoDecoder *decoder,GstVideoInfo i
     }
 }
 
+static GstCaps *
+gst_aml_v4l2_video_dec_predict_caps(GstVideoDecoder *decoder)
+{
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(decoder);
+    GstCaps *filter, *caps;
+
+    if (!self->probed_srccaps)
+        return NULL;
+
+    /* Query downstream with the size from the sequence header while the
+     * hardware decodes the first frame, the result is checked against the
+     * acquired format once SOURCE_CHANGE arrives */
+    filter = gst_caps_copy(self->probed_srccaps);
+    gst_caps_set_simple(filter,
+                        "width", G_TYPE_INT, self->header_info.width,
+                        "height", G_TYPE_INT, self->header_info.height, NULL);
+    caps = gst_pad_peer_query_caps(decoder->srcpad, filter);
+    gst_caps_unref(filter);
+
+    if (gst_caps_is_empty(caps))
+    {
+        gst_caps_unref(caps);
+        return NULL;
+    }
+
+    GST_DEBUG_OBJECT(self, "Predicted %dx%d, caps: %" GST_PTR_FORMAT,
+                     self->header_info.width, self->header_info.height, caps);
+    return caps;
+}
+
 static void
 gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
 {
@@ -958,6 +2561,7 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
     GstBufferPool *pool;
     GstVideoCodecFrame *frame;
     GstBuffer *buffer = NULL;
+    GstBuffer *preview;
     GstFlowReturn ret;
 
     if (G_UNLIKELY(!GST_AML_V4L2_IS_ACTIVE(self->v4l2capture)))
@@ -965,6 +2569,12 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
         GstVideoInfo info;
         GstCaps *acquired_caps, *available_caps, *caps, *filter;
         GstStructure *st;
+        GstAmlV4l2IOMode req_mode = self->v4l2capture->req_mode;
+
+        /* header_info is only read once header_parsed is seen set */
+        if (g_atomic_int_get(&self->header_parsed) && !self->predicted_caps)
+            self->predicted_caps = gst_aml_v4l2_video_dec_predict_caps(decoder);
+
         GST_DEBUG_OBJECT(self, "waitting source change event");
         /* Wait until received SOURCE_CHANGE event to get right video format */
         while (self->v4l2capture->can_wait_event && self->v4l2capture->need_wait_event)
@@ -990,6 +2600,9 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
         }
         self->v4l2capture->need_wait_event = FALSE;
 
+        /* from the previous format */
+        gst_buffer_replace(&self->last_good, NULL);
+
         if (TRUE == self->v4l2output->is_svp)
         {
             GstPad *peer;
@@ -1010,13 +2623,6 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
             }
         }
 
-        if (self->v4l2capture->need_drop_event)
-        {
-          // drop V4L2_EVENT_SOURCE_CHANGE
-          gst_v4l2_drop_event(self->v4l2capture);
-          self->v4l2capture->need_drop_event = FALSE;
-        }
-
         if (!gst_aml_v4l2_object_acquire_format(self->v4l2capture, &info))
             goto not_negotiated;
 
@@ -1042,7 +2648,31 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
         GST_DEBUG_OBJECT(self, "Filtered caps: %" GST_PTR_FORMAT, filter);
         gst_caps_unref(acquired_caps);
         gst_caps_unref(available_caps);
-        caps = gst_pad_peer_query_caps(decoder->srcpad, filter);
+
+        caps = NULL;
+        if (self->decode_only)
+        {
+            /* downstream is never asked, take the first raw format */
+            caps = gst_caps_copy_nth(filter, 0);
+            gst_caps_replace(&self->predicted_caps, NULL);
+            g_atomic_int_set(&self->header_parsed, FALSE);
+        }
+        else if (self->predicted_caps)
+        {
+            caps = gst_caps_intersect_full(self->predicted_caps, filter, GST_CAPS_INTERSECT_FIRST);
+            if (gst_caps_is_empty(caps))
+            {
+                GST_DEBUG_OBJECT(self, "Predicted caps don't match %dx%d depth %u, fall back to peer query",
+                                 info.width, info.height, GST_VIDEO_INFO_COMP_DEPTH(&info, 0));
+                gst_caps_unref(caps);
+                caps = NULL;
+            }
+            gst_caps_replace(&self->predicted_caps, NULL);
+            g_atomic_int_set(&self->header_parsed, FALSE);
+        }
+
+        if (!caps)
+            caps = gst_pad_peer_query_caps(decoder->srcpad, filter);
         gst_caps_unref(filter);
 
         GST_DEBUG_OBJECT(self, "Possible decoded caps: %" GST_PTR_FORMAT, caps);
@@ -1057,6 +2687,14 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
 
         GST_DEBUG_OBJECT(self, "Chosen decoded caps: %" GST_PTR_FORMAT, caps);
 
+        /* importing needs a downstream pool, decode-only uses our own buffers
+         * for this format only, io-mode is restored once allocated */
+        if (self->decode_only && req_mode == GST_V4L2_IO_DMABUF_IMPORT)
+        {
+            GST_DEBUG_OBJECT(self, "decode-only, not importing capture buffers");
+            self->v4l2capture->req_mode = GST_V4L2_IO_AUTO;
+        }
+
         /* Try to set negotiated format, on success replace acquired format */
         if (gst_aml_v4l2_object_set_format(self->v4l2capture, caps, &error))
             gst_video_info_from_caps(&info, caps);
@@ -1064,7 +2702,15 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
             gst_aml_v4l2_clear_error(&error);
         gst_caps_unref(caps);
         gst_aml_v4l2_video_dec_set_output_status(decoder,info);
-        if (!gst_video_decoder_negotiate(decoder))
+        if (self->decode_only)
+        {
+            gboolean allocated = gst_aml_v4l2_video_dec_null_allocation(self, &info);
+
+            self->v4l2capture->req_mode = req_mode;
+            if (!allocated)
+                goto not_negotiated;
+        }
+        else if (!gst_video_decoder_negotiate(decoder))
         {
             if (GST_PAD_IS_FLUSHING(decoder->srcpad))
                 goto flushing;
@@ -1095,7 +2741,10 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
          * stream lock. we know that the acquire may need to poll until more frames
          * comes in and holding this lock would prevent that.
          */
-        pool = gst_video_decoder_get_buffer_pool(decoder);
+        if (self->decode_only)
+            pool = self->v4l2capture->pool ? gst_object_ref(self->v4l2capture->pool) : NULL;
+        else
+            pool = gst_video_decoder_get_buffer_pool(decoder);
 
         /* Pool may be NULL if we started going to READY state */
         if (pool == NULL)
@@ -1114,12 +2763,17 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
             {
                 GST_BUFFER_DURATION(buffer) = GST_BUFFER_DURATION(buffer)/2;
             }
+            else
+            {
+                GST_BUFFER_DURATION(buffer) = gst_aml_v4l2_timestamp_duration(&self->ts, 1);
+            }
             GST_BUFFER_FLAG_UNSET(buffer, GST_VIDEO_BUFFER_FLAG_INTERLACED);
-            //reset pts
+            //the driver outputs 0 pts for the second field
             if (GST_BUFFER_TIMESTAMP (buffer) == 0LL)
             {
-                double rate = ((double)self->input_state->info.fps_n/(double)self->input_state->info.fps_d)*2;
-                GST_BUFFER_TIMESTAMP(buffer) = self->last_out_pts + 1000000000LL/rate;
+                GstClockTime ts = gst_aml_v4l2_timestamp_peek(&self->ts);
+                if (GST_CLOCK_TIME_IS_VALID(ts))
+                    GST_BUFFER_TIMESTAMP(buffer) = ts;
             }
         }
 
@@ -1127,13 +2781,10 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
 
         if (ret == GST_FLOW_OK && GST_BUFFER_FLAG_IS_SET(buffer,GST_AML_V4L2_BUFFER_FLAG_LAST_EMPTY)) {
             GST_LOG_OBJECT(decoder, "Get GST_AML_V4L2_FLOW_LAST_BUFFER");
-            self->v4l2capture->need_drop_event = TRUE;
             gst_aml_v4l2_buffer_pool_process(v4l2_pool, &buffer);
             if (self->is_res_chg) {
                 //we must release last buffer
                 gst_buffer_unref(buffer);
-                //if resolution changed event received,we should set need_drop_event to false
-                self->v4l2capture->need_drop_event = FALSE;
                 gst_aml_v4l2_object_stop(self->v4l2capture);
                 //unblock flush start event
                 g_mutex_lock(&self->res_chg_lock);
@@ -1142,6 +2793,9 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
                 g_mutex_unlock(&self->res_chg_lock);
                 return;
             } else {
+                /* the driver follows the last buffer with a source change of
+                 * its own, not the one of the next stream */
+                self->v4l2capture->stale_source_changes++;
                 goto beach;
             }
         }
@@ -1164,8 +2818,34 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
         GST_LOG_OBJECT(decoder, "Process output buffer (switching flow outstanding num:%d)", self->v4l2capture->outstanding_buf_num);
         ret = gst_aml_v4l2_buffer_pool_process(v4l2_pool, &buffer);
 
-        GST_DEBUG_OBJECT(decoder, "send pts:%lld - %" GST_TIME_FORMAT, GST_BUFFER_PTS(buffer), GST_TIME_ARGS(GST_BUFFER_PTS(buffer)));
-        g_signal_emit (self, g_signals[SIGNAL_DECODED_PTS], 0, GST_BUFFER_PTS(buffer));
+        if (buffer)
+        {
+            guint32 flags = 0;
+
+            if (!GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+                flags |= GST_AML_V4L2_PTS_RING_FLAG_KEYFRAME;
+            if (ret == GST_AML_V4L2_FLOW_CORRUPTED_BUFFER || GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_CORRUPTED))
+                flags |= GST_AML_V4L2_PTS_RING_FLAG_CORRUPTED;
+            if (self->v4l2capture->info.interlace_mode == GST_VIDEO_INTERLACE_MODE_INTERLEAVED)
+                flags |= GST_AML_V4L2_PTS_RING_FLAG_FIELD;
+            gst_aml_v4l2_pts_ring_push(self->pts_ring, GST_BUFFER_PTS(buffer), flags);
+            if (self->decode_only && (flags & GST_AML_V4L2_PTS_RING_FLAG_CORRUPTED))
+            {
+                GST_OBJECT_LOCK(self);
+                self->decoded_corrupted++;
+                GST_OBJECT_UNLOCK(self);
+            }
+
+            /* the ring holds every pts, in batched mode the signal is only a
+             * wake up carrying the latest one */
+            if (self->decoded_pts_interval &&
+                ++self->decoded_pts_count >= self->decoded_pts_interval)
+            {
+                GST_DEBUG_OBJECT(decoder, "send pts:%lld - %" GST_TIME_FORMAT, GST_BUFFER_PTS(buffer), GST_TIME_ARGS(GST_BUFFER_PTS(buffer)));
+                g_signal_emit (self, g_signals[SIGNAL_DECODED_PTS], 0, GST_BUFFER_PTS(buffer));
+                self->decoded_pts_count = 0;
+            }
+        }
 
         if (ret == GST_AML_V4L2_FLOW_SOURCE_CHANGE)
         {
@@ -1173,41 +2853,60 @@ gst_aml_v4l2_video_dec_loop(GstVideoDecoder *decoder)
             return;
         }
 
+        /* already dropped by the pool, nothing to conceal */
+        if (ret == GST_AML_V4L2_FLOW_CORRUPTED_BUFFER)
+            gst_aml_v4l2_video_dec_error_burst(self, &self->errors_truncated);
+
     } while (ret == GST_AML_V4L2_FLOW_CORRUPTED_BUFFER);
 
     if (ret != GST_FLOW_OK)
         goto beach;
 
+    if (self->decode_only)
+    {
+        gst_aml_v4l2_video_dec_null_capture(self, buffer);
+        return;
+    }
+
     frame = gst_aml_v4l2_video_dec_get_right_frame(decoder, GST_BUFFER_TIMESTAMP (buffer));
     if (frame)
     {
-        if (!GST_CLOCK_TIME_IS_VALID(frame->pts))
-        {
-            if (!GST_CLOCK_TIME_IS_VALID(self->last_out_pts))
-            {
-                if (GST_CLOCK_TIME_IS_VALID(frame->dts))
-                {
-                    GST_BUFFER_TIMESTAMP(buffer) = frame->dts;
-                }
-                else
-                {
-                    GST_WARNING_OBJECT (decoder,"sorry,we have no baseline to calculate pts");
-                    goto beach;
-                }
-            }
-            else
-            {
-                double rate = ((double)self->input_state->info.fps_n/(double)self->input_state->info.fps_d);
-                GST_BUFFER_TIMESTAMP(buffer) = self->last_out_pts + 1000000000LL/rate;
-            }
-        }
-        self->last_out_pts = GST_BUFFER_TIMESTAMP(buffer);
+        guint fields = (self->v4l2capture->info.interlace_mode == GST_VIDEO_INTERLACE_MODE_INTERLEAVED) ? 1 : 2;
+        GstClockTime pts = GST_CLOCK_TIME_IS_VALID(frame->pts) ? GST_BUFFER_TIMESTAMP(buffer) : GST_CLOCK_TIME_NONE;
+
+        GST_BUFFER_TIMESTAMP(buffer) = gst_aml_v4l2_timestamp_next(&self->ts, pts, frame->dts, fields);
+        if (!GST_CLOCK_TIME_IS_VALID(GST_BUFFER_TIMESTAMP(buffer)))
+            GST_WARNING_OBJECT (decoder, "no baseline to calculate pts, leave it to the base class");
+        if (!GST_BUFFER_DURATION_IS_VALID(buffer))
+            GST_BUFFER_DURATION(buffer) = gst_aml_v4l2_timestamp_duration(&self->ts, fields);
         frame->output_buffer = buffer;
         frame->pts = GST_BUFFER_TIMESTAMP(buffer);
         frame->duration = GST_BUFFER_DURATION(buffer);
         buffer = NULL;
+
+        if (G_UNLIKELY(GST_CLOCK_TIME_IS_VALID(self->first_frame_start)))
+        {
+            GST_INFO_OBJECT(decoder, "time to first frame: %" GST_TIME_FORMAT " (fast-start %d)",
+                            GST_TIME_ARGS(GST_CLOCK_DIFF(self->first_frame_start, gst_util_get_timestamp())),
+                            self->fast_start);
+            self->first_frame_start = GST_CLOCK_TIME_NONE;
+        }
+        gst_aml_v4l2_video_dec_heap_remove(self, frame);
+        if (!gst_aml_v4l2_video_dec_error_policy(self, frame))
+        {
+            ret = gst_video_decoder_drop_frame(decoder, frame);
+            if (ret != GST_FLOW_OK)
+                goto beach;
+            return;
+        }
+
+        preview = gst_aml_v4l2_video_dec_preview_wrap(self, frame->output_buffer);
         ret = gst_video_decoder_finish_frame(decoder, frame);
 
+        /* after finish_frame, the srcpad segment is the one of this frame */
+        if (preview)
+            gst_aml_v4l2_video_dec_push_preview(self, preview);
+
         if (ret != GST_FLOW_OK)
             goto beach;
     }
@@ -1252,7 +2951,27 @@ beach:
     gst_buffer_replace(&buffer, NULL);
     self->output_flow = ret;
     gst_aml_v4l2_object_unlock(self->v4l2output);
-    gst_pad_pause_task(decoder->srcpad);
+    gst_aml_v4l2_video_dec_pause_task(self);
+}
+
+/* TRUE for the keyframes thumbnail mode decodes */
+static gboolean
+gst_aml_v4l2_video_dec_thumbnail_keep(GstAmlV4l2VideoDec *self, GstVideoCodecFrame *frame)
+{
+    GstClockTime ts = GST_CLOCK_TIME_IS_VALID(frame->pts) ? frame->pts : frame->dts;
+
+    if (!GST_VIDEO_CODEC_FRAME_IS_SYNC_POINT(frame))
+        return FALSE;
+
+    if (self->thumbnail_keyframes)
+        return (self->thumbnail_count++ % self->thumbnail_interval) == 0;
+
+    if (GST_CLOCK_TIME_IS_VALID(ts) && GST_CLOCK_TIME_IS_VALID(self->thumbnail_last) &&
+        ts >= self->thumbnail_last && ts - self->thumbnail_last < (GstClockTime)self->thumbnail_interval * GST_SECOND)
+        return FALSE;
+
+    self->thumbnail_last = ts;
+    return TRUE;
 }
 
 static GstFlowReturn
@@ -1270,9 +2989,43 @@ gst_aml_v4l2_video_dec_handle_frame(GstVideoDecoder *decoder,
 
     GST_DEBUG_OBJECT(self, "Handling frame %d", frame->system_frame_number);
 
+    /* chunks of an unparsed stream can't be skipped */
+    if (self->thumbnail_interval && !self->v4l2output->stream_mode &&
+        !gst_aml_v4l2_video_dec_thumbnail_keep(self, frame))
+    {
+        GST_LOG_OBJECT(self, "thumbnail mode, skipping frame %d", frame->system_frame_number);
+        gst_video_decoder_release_frame(decoder, frame);
+        return GST_FLOW_OK;
+    }
+
+    if (G_UNLIKELY(g_atomic_int_get(&self->resync_pending)) && !self->v4l2output->stream_mode)
+    {
+        if (!GST_VIDEO_CODEC_FRAME_IS_SYNC_POINT(frame))
+        {
+            GST_LOG_OBJECT(self, "resync, discarding frame %d", frame->system_frame_number);
+            GST_OBJECT_LOCK(self);
+            self->resync_discarded++;
+            GST_OBJECT_UNLOCK(self);
+            gst_video_decoder_release_frame(decoder, frame);
+            return GST_FLOW_OK;
+        }
+
+        GST_DEBUG_OBJECT(self, "resync on keyframe %d", frame->system_frame_number);
+        g_atomic_int_set(&self->resync_pending, FALSE);
+    }
+
+    gst_aml_v4l2_video_dec_heap_push(self, frame);
+
     if (G_UNLIKELY(!g_atomic_int_get(&self->active)))
         goto flushing;
 
+    if (self->decode_only && !GST_CLOCK_TIME_IS_VALID(self->decode_start))
+    {
+        GST_OBJECT_LOCK(self);
+        self->decode_start = gst_util_get_timestamp();
+        GST_OBJECT_UNLOCK(self);
+    }
+
     if (G_UNLIKELY(!GST_AML_V4L2_IS_ACTIVE(self->v4l2output)))
     {
         if (!self->input_state)
@@ -1312,6 +3065,24 @@ gst_aml_v4l2_video_dec_handle_frame(GstVideoDecoder *decoder,
             processed = TRUE;
         }
 
+        if (!g_atomic_int_get(&self->header_parsed))
+        {
+            GstAmlV4l2CodecHeaderInfo header_info;
+            gboolean parsed;
+
+            parsed = gst_aml_v4l2_codec_parse_header(self->input_state->caps, codec_data, &header_info);
+            if (!parsed && !processed)
+                parsed = gst_aml_v4l2_codec_parse_header(self->input_state->caps,
+                                                         frame->input_buffer, &header_info);
+
+            /* published to the capture loop by the flag */
+            if (parsed)
+            {
+                self->header_info = header_info;
+                g_atomic_int_set(&self->header_parsed, TRUE);
+            }
+        }
+
         /* Ensure input internal pool is active */
         if (!gst_buffer_pool_is_active(pool))
         {
@@ -1345,7 +3116,7 @@ gst_aml_v4l2_video_dec_handle_frame(GstVideoDecoder *decoder,
          * padding. */
     }
 
-    task_state = gst_pad_get_task_state(GST_VIDEO_DECODER_SRC_PAD(self));
+    task_state = gst_aml_v4l2_video_dec_get_task_state(self);
     if (task_state == GST_TASK_STOPPED || task_state == GST_TASK_PAUSED)
     {
         /* It's possible that the processing thread stopped due to an error */
@@ -1362,8 +3133,7 @@ gst_aml_v4l2_video_dec_handle_frame(GstVideoDecoder *decoder,
         /* Start the processing task, when it quits, the task will disable input
          * processing to unlock input if draining, or prevent potential block */
         self->output_flow = GST_FLOW_FLUSHING;
-        if (!gst_pad_start_task(decoder->srcpad,
-                                (GstTaskFunction)gst_aml_v4l2_video_dec_loop, self, NULL))
+        if (!gst_aml_v4l2_video_dec_start_task(self))
             goto start_task_failed;
     }
 
@@ -1384,8 +3154,7 @@ gst_aml_v4l2_video_dec_handle_frame(GstVideoDecoder *decoder,
 
         if (ret == GST_FLOW_FLUSHING)
         {
-            if (gst_pad_get_task_state(GST_VIDEO_DECODER_SRC_PAD(self)) !=
-                GST_TASK_STARTED)
+            if (gst_aml_v4l2_video_dec_get_task_state(self) != GST_TASK_STARTED)
                 ret = self->output_flow;
             goto drop;
         }
@@ -1395,6 +3164,14 @@ gst_aml_v4l2_video_dec_handle_frame(GstVideoDecoder *decoder,
         }
     }
 
+    /* decode-only: outputs are never matched to their input */
+    if (self->decode_only)
+    {
+        gst_aml_v4l2_video_dec_heap_remove(self, frame);
+        gst_video_decoder_release_frame(decoder, frame);
+        return ret;
+    }
+
     /* No need to keep input arround */
     tmp = frame->input_buffer;
     frame->input_buffer = gst_buffer_new();
@@ -1449,6 +3226,7 @@ process_failed:
 }
 drop:
 {
+    gst_aml_v4l2_video_dec_heap_remove(self, frame);
     gst_video_decoder_drop_frame(decoder, frame);
     return ret;
 }
@@ -1470,7 +3248,16 @@ gst_aml_v4l2_video_dec_decide_allocation(GstVideoDecoder *decoder,
         latency = self->v4l2capture->min_buffers * self->v4l2capture->duration;
         GST_DEBUG_OBJECT(self, "Setting latency: %" GST_TIME_FORMAT " (%" G_GUINT32_FORMAT " * %" G_GUINT64_FORMAT, GST_TIME_ARGS(latency),
                          self->v4l2capture->min_buffers, self->v4l2capture->duration);
-        gst_video_decoder_set_latency(decoder, latency, latency);
+        if (self->v4l2output->low_latency_mode || self->v4l2output->thumbnail_mode)
+        {
+            /* Frames come out in decode order as soon as they are decoded,
+             * the capture queue depth is only an upper bound */
+            GST_DEBUG_OBJECT(self, "Low latency, min latency: %" GST_TIME_FORMAT,
+                             GST_TIME_ARGS(self->v4l2capture->duration));
+            gst_video_decoder_set_latency(decoder, self->v4l2capture->duration, latency);
+        }
+        else
+            gst_video_decoder_set_latency(decoder, latency, latency);
     }
     else
     {
@@ -1550,8 +3337,11 @@ gst_aml_v4l2_video_dec_sink_event(GstVideoDecoder *decoder, GstEvent *event)
     {
         GstStructure *s;
         GstEvent *event;
+
+        self->preview_started = FALSE;
         GST_DEBUG_OBJECT(self, "new private event");
-        s = gst_structure_new("private_signal", "obj_ptr", G_TYPE_POINTER, self, "sig_name", G_TYPE_STRING, "decoded-pts", NULL);
+        s = gst_structure_new("private_signal", "obj_ptr", G_TYPE_POINTER, self, "sig_name", G_TYPE_STRING, "decoded-pts",
+                              "pts_ring", G_TYPE_POINTER, self->pts_ring, NULL);
         event = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM, s);
         GST_DEBUG_OBJECT(self, "before Send private_signal Event :%p", event);
         gst_pad_push_event (decoder->sinkpad, event);
@@ -1614,6 +3404,34 @@ gst_aml_v4l2_video_dec_sink_event(GstVideoDecoder *decoder, GstEvent *event)
         }
         break;
     }
+    case GST_EVENT_CUSTOM_DOWNSTREAM_OOB:
+    {
+        const GstStructure *s = gst_event_get_structure(event);
+        GstCaps *caps = NULL;
+
+        if (gst_structure_has_name(s, "aml-v4l2-standby") &&
+            gst_structure_get(s, "caps", GST_TYPE_CAPS, &caps, NULL))
+        {
+            GST_DEBUG_OBJECT(self, "standby hint %" GST_PTR_FORMAT, caps);
+            gst_aml_v4l2_video_dec_set_standby_caps(self, caps);
+            gst_caps_unref(caps);
+        }
+        break;
+    }
+    case GST_EVENT_EOS:
+        if (self->decode_only)
+        {
+            /* drain here, the base class drain then finds nothing left.
+             * Nothing was pushed, it counts that as one decoding error,
+             * below max-errors that is a warning */
+            GST_VIDEO_DECODER_STREAM_LOCK(decoder);
+            gst_aml_v4l2_video_dec_finish(decoder);
+            GST_VIDEO_DECODER_STREAM_UNLOCK(decoder);
+            gst_element_post_message(GST_ELEMENT(self),
+                                     gst_message_new_element(GST_OBJECT(self),
+                                                             gst_aml_v4l2_video_dec_decode_stats(self)));
+        }
+        break;
     case GST_EVENT_FLUSH_START:
         GST_DEBUG_OBJECT(self, "flush start");
 
@@ -1625,9 +3443,12 @@ gst_aml_v4l2_video_dec_sink_event(GstVideoDecoder *decoder, GstEvent *event)
         }
         g_mutex_unlock (&self->res_chg_lock);
 
-        self->last_out_pts = GST_CLOCK_TIME_NONE;
+        gst_aml_v4l2_timestamp_reset(&self->ts);
+        self->first_frame_start = gst_util_get_timestamp();
         gst_aml_v4l2_object_unlock(self->v4l2output);
         gst_aml_v4l2_object_unlock(self->v4l2capture);
+        /* drops the queued previews and unblocks the preview task */
+        gst_aml_v4l2_video_dec_preview_event(self, gst_event_new_flush_start());
         break;
     default:
         break;
@@ -1639,10 +3460,19 @@ gst_aml_v4l2_video_dec_sink_event(GstVideoDecoder *decoder, GstEvent *event)
     {
     case GST_EVENT_FLUSH_START:
         /* The processing thread should stop now, wait for it */
-        gst_pad_stop_task(decoder->srcpad);
+        gst_aml_v4l2_video_dec_stop_task(self);
         self->codec_data_inject = FALSE;
         GST_DEBUG_OBJECT(self, "flush start done");
         break;
+    case GST_EVENT_FLUSH_STOP:
+        gst_aml_v4l2_video_dec_preview_event(self, gst_event_new_flush_stop(TRUE));
+        gst_segment_init(&self->preview_segment, GST_FORMAT_UNDEFINED);
+        break;
+    case GST_EVENT_EOS:
+        /* drained by now, all previews were queued */
+        if (self->preview_started)
+            gst_aml_v4l2_video_dec_preview_event(self, gst_event_new_eos());
+        break;
     default:
         break;
     }
@@ -1650,19 +3480,49 @@ gst_aml_v4l2_video_dec_sink_event(GstVideoDecoder *decoder, GstEvent *event)
     return ret;
 }
 
+static gboolean
+gst_aml_v4l2_video_dec_post_message(GstElement *element, GstMessage *message)
+{
+    GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(element);
+
+    /* the srcpad posts ENTER and LEAVE from inside its task thread, that is
+     * where the scheduling settings can be applied and undone */
+    if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_STREAM_STATUS &&
+        GST_MESSAGE_SRC(message) == GST_OBJECT_CAST(GST_VIDEO_DECODER_SRC_PAD(self)))
+    {
+        GstStreamStatusType type;
+        GstElement *owner;
+
+        gst_message_parse_stream_status(message, &type, &owner);
+        if (type == GST_STREAM_STATUS_TYPE_ENTER)
+        {
+            GST_OBJECT_LOCK(self);
+            if (!gst_aml_v4l2_sched_params_is_default(&self->sched))
+                self->sched_saved = gst_aml_v4l2_sched_apply(&self->sched, GST_OBJECT(self));
+            GST_OBJECT_UNLOCK(self);
+        }
+        else if (type == GST_STREAM_STATUS_TYPE_LEAVE && self->sched_saved)
+        {
+            gst_aml_v4l2_sched_restore(self->sched_saved);
+            self->sched_saved = NULL;
+        }
+    }
+
+    return GST_ELEMENT_CLASS(parent_class)->post_message(element, message);
+}
+
 static GstStateChangeReturn
 gst_aml_v4l2_video_dec_change_state(GstElement *element,
                                     GstStateChange transition)
 {
     GstAmlV4l2VideoDec *self = GST_AML_V4L2_VIDEO_DEC(element);
-    GstVideoDecoder *decoder = GST_VIDEO_DECODER(element);
 
     if (transition == GST_STATE_CHANGE_PAUSED_TO_READY)
     {
         g_atomic_int_set(&self->active, FALSE);
         gst_aml_v4l2_object_unlock(self->v4l2output);
         gst_aml_v4l2_object_unlock(self->v4l2capture);
-        gst_pad_stop_task(decoder->srcpad);
+        gst_aml_v4l2_video_dec_stop_task(self);
     }
 
     return GST_ELEMENT_CLASS(parent_class)->change_state(element, transition);
@@ -1675,6 +3535,7 @@ gst_aml_v4l2_video_dec_dispose(GObject *object)
 
     gst_caps_replace(&self->probed_sinkcaps, NULL);
     gst_caps_replace(&self->probed_srccaps, NULL);
+    gst_caps_replace(&self->predicted_caps, NULL);
 
     G_OBJECT_CLASS(parent_class)->dispose(object);
 }
@@ -1687,8 +3548,26 @@ gst_aml_v4l2_video_dec_finalize(GObject *object)
     gst_aml_v4l2_object_destroy(self->v4l2capture);
     gst_aml_v4l2_object_destroy(self->v4l2output);
 
+    gst_caps_replace(&self->standby_caps, NULL);
+    g_mutex_clear(&self->standby_lock);
+    gst_object_unref(self->dmabuf_allocator);
+    if (self->decoded_checksum)
+        g_checksum_free(self->decoded_checksum);
+    gst_buffer_replace(&self->last_good, NULL);
+
+    gst_aml_v4l2_video_dec_preview_clear(self);
+    g_mutex_clear(&self->preview_lock);
+    g_cond_clear(&self->preview_cond);
+
     g_mutex_clear(&self->res_chg_lock);
     g_cond_clear(&self->res_chg_cond);
+    g_ptr_array_free(self->frame_heap, TRUE);
+    g_free(self->pts_ring);
+    if (self->reactor)
+        gst_aml_v4l2_reactor_unref(self->reactor);
+    g_mutex_clear(&self->reactor_lock);
+    g_cond_clear(&self->reactor_cond);
+    gst_aml_v4l2_sched_params_clear(&self->sched);
 
 #if GST_IMPORT_LGE_PROP
     if (self->lge_ctxt)
@@ -1709,10 +3588,69 @@ static void
 gst_aml_v4l2_video_dec_init(GstAmlV4l2VideoDec *self)
 {
     /* V4L2 object are created in subinstance_init */
-    self->last_out_pts = GST_CLOCK_TIME_NONE;
+    gst_aml_v4l2_timestamp_set_framerate(&self->ts, 0, 1);
+    gst_aml_v4l2_timestamp_reset(&self->ts);
     self->is_secure_path = FALSE;
     self->is_res_chg = FALSE;
     self->codec_data_inject = FALSE;
+    self->fast_start = FALSE;
+    self->first_frame_start = GST_CLOCK_TIME_NONE;
+    self->header_parsed = FALSE;
+    self->predicted_caps = NULL;
+    self->frame_heap = g_ptr_array_new();
+    self->pts_ring = g_new0(GstAmlV4l2PtsRing, 1);
+    self->decoded_pts_interval = 1;
+    self->decoded_pts_count = 0;
+    self->shared_reactor = FALSE;
+    self->reactor = NULL;
+    self->reactor_src = NULL;
+    self->reactor_state = GST_TASK_STOPPED;
+    g_mutex_init(&self->reactor_lock);
+    g_cond_init(&self->reactor_cond);
+    memset(&self->sched, 0, sizeof(self->sched));
+    self->sched_saved = NULL;
+    g_mutex_init(&self->standby_lock);
+    self->standby_caps = NULL;
+    self->standby_output = NULL;
+    self->standby_capture = NULL;
+    self->standby_srccaps = NULL;
+    self->standby_thread = NULL;
+    self->standby_ready = FALSE;
+    self->preview_pad = NULL;
+    self->preview_started = FALSE;
+    self->preview_caps_pending = FALSE;
+    self->preview_disabled = FALSE;
+    gst_video_info_init(&self->preview_info);
+    gst_video_info_init(&self->preview_main_info);
+    gst_segment_init(&self->preview_segment, GST_FORMAT_UNDEFINED);
+    g_mutex_init(&self->preview_lock);
+    g_cond_init(&self->preview_cond);
+    g_queue_init(&self->preview_queue);
+    self->preview_flushing = TRUE;
+    self->dmabuf_allocator = gst_dmabuf_allocator_new();
+    self->thumbnail_interval = 0;
+    self->thumbnail_keyframes = FALSE;
+    self->thumbnail_count = 0;
+    self->thumbnail_last = GST_CLOCK_TIME_NONE;
+    self->decode_only = FALSE;
+    self->decode_checksum = FALSE;
+    self->decoded_frames = 0;
+    self->decoded_corrupted = 0;
+    self->decode_start = GST_CLOCK_TIME_NONE;
+    self->decode_last = GST_CLOCK_TIME_NONE;
+    self->decoded_checksum = NULL;
+    self->error_policy = GST_AML_V4L2_ERROR_CONCEAL;
+    self->resync_threshold = 0;
+    self->error_burst = 0;
+    self->resync_pending = FALSE;
+    self->last_good = NULL;
+    self->errors_truncated = 0;
+    self->errors_decode = 0;
+    self->errors_concealed = 0;
+    self->errors_repeated = 0;
+    self->errors_dropped = 0;
+    self->resyncs = 0;
+    self->resync_discarded = 0;
     g_mutex_init(&self->res_chg_lock);
     g_cond_init(&self->res_chg_cond);
 #if GST_IMPORT_LGE_PROP
@@ -1743,7 +3681,7 @@ gst_aml_v4l2_video_dec_subinstance_init(GTypeInstance *instance, gpointer g_clas
                                                 V4L2_BUF_TYPE_VIDEO_CAPTURE, klass->default_device,
                                                 gst_aml_v4l2_get_input, gst_aml_v4l2_set_input, NULL);
     self->v4l2capture->need_wait_event = TRUE;
-    self->v4l2capture->need_drop_event = FALSE;
+    self->v4l2capture->stale_source_changes = 0;
 }
 
 static void
@@ -1794,6 +3732,12 @@ gst_aml_v4l2_video_dec_class_init(GstAmlV4l2VideoDecClass *klass)
 
     element_class->change_state =
         GST_DEBUG_FUNCPTR(gst_aml_v4l2_video_dec_change_state);
+    element_class->post_message =
+        GST_DEBUG_FUNCPTR(gst_aml_v4l2_video_dec_post_message);
+    element_class->request_new_pad =
+        GST_DEBUG_FUNCPTR(gst_aml_v4l2_video_dec_request_new_pad);
+    element_class->release_pad =
+        GST_DEBUG_FUNCPTR(gst_aml_v4l2_video_dec_release_pad);
 
   g_signals[SIGNAL_DECODED_PTS] = g_signal_new ("decoded-pts",
         G_TYPE_FROM_CLASS(GST_ELEMENT_CLASS(klass)),
@@ -1806,7 +3750,161 @@ gst_aml_v4l2_video_dec_class_init(GstAmlV4l2VideoDecClass *klass)
         1,
         G_TYPE_UINT64);
 
+  /* writes capture-pool-stat to $GST_DEBUG_DUMP_AMLV4L2DEC_STAT_DIR */
+  g_signals[SIGNAL_DUMP_POOL_STAT] = g_signal_new_class_handler ("dump-pool-stat",
+        G_TYPE_FROM_CLASS(GST_ELEMENT_CLASS(klass)),
+        G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION,
+        G_CALLBACK(gst_aml_v4l2_video_dec_dump_pool_stat),
+        NULL, /* accumulator */
+        NULL, /* accu data */
+        g_cclosure_marshal_generic,
+        G_TYPE_BOOLEAN,
+        0);
+
     gst_aml_v4l2_object_install_m2m_properties_helper(gobject_class);
+
+    g_object_class_install_property(gobject_class, PROP_FAST_START,
+                                    g_param_spec_boolean("fast-start", "fast start",
+                                                         "Use the pad template caps instead of probing the device on open, "
+                                                         "full probing is deferred to the first renegotiation",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_DECODED_PTS_INTERVAL,
+                                    g_param_spec_uint("decoded-pts-interval", "decoded pts interval",
+                                                      "Emit decoded-pts once every N decoded buffers, 0 disables the signal. "
+                                                      "The signal carries the pts of the latest buffer only, the skipped ones "
+                                                      "are always available in the pts_ring of the private_signal event",
+                                                      0, G_MAXUINT, 1,
+                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_SHARED_REACTOR,
+                                    g_param_spec_boolean("shared-reactor", "shared reactor",
+                                                         "Drive the capture loop from one epoll thread and worker pool shared "
+                                                         "by all instances instead of a thread per instance. A dispatch runs a "
+                                                         "whole loop iteration including the push downstream, which blocks on "
+                                                         "a synchronized sink: every playing instance still holds a worker, "
+                                                         "only idle, paused and starved instances save their thread",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_CPU_AFFINITY,
+                                    g_param_spec_string("cpu-affinity", "cpu affinity",
+                                                        "CPUs the decoding thread may run on, e.g. \"4-7\" or \"2,6\". "
+                                                        "Applied when the thread starts",
+                                                        NULL,
+                                                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_SCHED_POLICY,
+                                    g_param_spec_enum("sched-policy", "sched policy",
+                                                      "Scheduling policy of the decoding thread, real time policies "
+                                                      "need CAP_SYS_NICE",
+                                                      GST_TYPE_AML_V4L2_SCHED_POLICY, GST_AML_V4L2_SCHED_OTHER,
+                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_SCHED_PRIORITY,
+                                    g_param_spec_int("sched-priority", "sched priority",
+                                                     "Real time priority of the decoding thread with sched-policy fifo or rr",
+                                                     0, 99, 0,
+                                                     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_NICE,
+                                    g_param_spec_int("nice", "nice",
+                                                     "Nice value of the decoding thread with sched-policy other",
+                                                     -20, 19, 0,
+                                                     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_THREAD_NAME,
+                                    g_param_spec_string("thread-name", "thread name",
+                                                        "Name of the decoding thread, at most 15 characters are kept",
+                                                        NULL,
+                                                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_ELASTIC_POOL,
+                                    g_param_spec_boolean("elastic-pool", "elastic pool",
+                                                         "Start the capture pool with the downstream and driver minimum and "
+                                                         "create buffers only when the decoder runs dry, giving unused ones "
+                                                         "back. Only in mmap and dmabuf io-mode: growing needs CREATE_BUFS, "
+                                                         "shrinking REMOVE_BUFS (Linux 6.10 and later), without it the pool "
+                                                         "shrinks back on the next negotiation only. Applied at the next "
+                                                         "negotiation",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_STANDBY_CAPS,
+                                    g_param_spec_boxed("standby-caps", "standby caps",
+                                                       "Caps of the next stream, at least media type, width and height. "
+                                                       "A second decoder context is configured for them in the background "
+                                                       "and swapped in when they are negotiated. Also settable with an "
+                                                       "\"aml-v4l2-standby\" custom downstream-oob event carrying \"caps\"",
+                                                       GST_TYPE_CAPS,
+                                                       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_THUMBNAIL_INTERVAL,
+                                    g_param_spec_uint("thumbnail-interval", "thumbnail interval",
+                                                      "Thumbnail mode: decode only one keyframe every N seconds, or every "
+                                                      "N keyframes with thumbnail-keyframes, with the smallest double write "
+                                                      "picture and no reorder delay. Needs parsed input, 0 disables. The "
+                                                      "decoder configuration is applied at the next negotiation",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_THUMBNAIL_KEYFRAMES,
+                                    g_param_spec_boolean("thumbnail-keyframes", "thumbnail keyframes",
+                                                         "Count thumbnail-interval in keyframes instead of seconds",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_DECODE_ONLY,
+                                    g_param_spec_boolean("decode-only", "decode only",
+                                                         "Measure the hardware decoder alone: capture buffers are requeued "
+                                                         "right after being dequeued, nothing is negotiated with or pushed "
+                                                         "downstream. See decode-stats, also posted as an element message at EOS",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_DECODE_CHECKSUM,
+                                    g_param_spec_boolean("decode-checksum", "decode checksum",
+                                                         "With decode-only, keep an MD5 of the visible planes of all decoded "
+                                                         "frames. Maps every frame, so costs decoding speed",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_DECODE_STATS,
+                                    g_param_spec_boxed("decode-stats", "decode stats",
+                                                       "decode-only results: frames, corrupted, elapsed (ns from the first "
+                                                       "input to the last output), fps, width, height and checksum",
+                                                       GST_TYPE_STRUCTURE,
+                                                       G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_ERROR_POLICY,
+                                    g_param_spec_enum("error-policy", "error policy",
+                                                      "Output for frames the driver flags as corrupted. repeat keeps one "
+                                                      "capture buffer referenced and falls back to conceal when the capture "
+                                                      "memory isn't dmabuf",
+                                                      GST_TYPE_AML_V4L2_ERROR_POLICY, GST_AML_V4L2_ERROR_CONCEAL,
+                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_RESYNC_THRESHOLD,
+                                    g_param_spec_uint("resync-threshold", "resync threshold",
+                                                      "After this many corrupted or truncated frames in a row, discard "
+                                                      "input until the next keyframe. Needs parsed input, 0 disables",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_ERROR_STATS,
+                                    g_param_spec_boxed("error-stats", "error stats",
+                                                       "Corrupted frame counters: truncated, decode-errors, concealed, "
+                                                       "repeated, dropped, resyncs and resync-discarded",
+                                                       GST_TYPE_STRUCTURE,
+                                                       G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(gobject_class, PROP_CAPTURE_POOL_STAT,
+                                    g_param_spec_boxed("capture-pool-stat", "capture pool stat",
+                                                       "Capture pool and other pool configs with the last snapshots of the "
+                                                       "queued, allocated, ready to free and other pool outstanding buffers",
+                                                       GST_TYPE_STRUCTURE,
+                                                       G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 #if GST_IMPORT_LGE_PROP
     gst_aml_v4l2_video_dec_install_lge_properties_helper(gobject_class);
 #endif
@@ -1828,6 +3926,10 @@ gst_aml_v4l2_video_dec_subclass_init(gpointer g_class, gpointer data)
     gst_element_class_add_pad_template(element_class,
                                        gst_pad_template_new("src", GST_PAD_SRC, GST_PAD_ALWAYS,
                                                             cdata->src_caps));
+    /* linear double-write picture, zero copy next to the AFBC output */
+    gst_element_class_add_pad_template(element_class,
+                                       gst_pad_template_new("preview", GST_PAD_SRC, GST_PAD_REQUEST,
+                                                            cdata->src_caps));
 
     gst_element_class_set_metadata(element_class, cdata->longname,
                                    "Codec/Decoder/Video/Hardware", cdata->description,
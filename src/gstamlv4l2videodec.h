@@ -27,6 +27,11 @@
 
 #include <gstamlv4l2object.h>
 #include <gstamlv4l2bufferpool.h>
+#include <aml-v4l2-codec-parser.h>
+#include <aml-v4l2-timestamp.h>
+#include <aml-v4l2-pts-ring.h>
+#include <aml-v4l2-reactor.h>
+#include <aml-v4l2-sched.h>
 
 #define GST_IMPORT_LGE_PROP 0
 
@@ -43,6 +48,17 @@ G_BEGIN_DECLS
 #define GST_IS_AML_V4L2_VIDEO_DEC_CLASS(obj) \
     (G_TYPE_CHECK_CLASS_TYPE((klass), GST_TYPE_AML_V4L2_VIDEO_DEC))
 
+#define GST_TYPE_AML_V4L2_ERROR_POLICY (gst_aml_v4l2_error_policy_get_type())
+GType gst_aml_v4l2_error_policy_get_type(void);
+
+/* what to output for a frame the driver flagged as corrupted */
+typedef enum
+{
+    GST_AML_V4L2_ERROR_CONCEAL, /* the concealed picture, flagged corrupted */
+    GST_AML_V4L2_ERROR_REPEAT,  /* the last good picture again */
+    GST_AML_V4L2_ERROR_DROP,
+} GstAmlV4l2ErrorPolicy;
+
 typedef struct _GstAmlV4l2VideoDec GstAmlV4l2VideoDec;
 #if GST_IMPORT_LGE_PROP
 typedef struct _GstAmlV4l2VideoDecLgeCtxt GstAmlV4l2VideoDecLgeCtxt;
@@ -74,9 +90,96 @@ struct _GstAmlV4l2VideoDec
     GMutex res_chg_lock;
     GCond res_chg_cond;
 
-    GstClockTime last_out_pts;
+    GstAmlV4l2Timestamp ts;
     gboolean codec_data_inject;
 
+    /* fast start: trust template caps, defer probing */
+    gboolean fast_start;
+    GstClockTime first_frame_start;
+
+    /* capture size predicted from the sequence header. header_info is
+     * written by the streaming thread before header_parsed is set, and read
+     * by the capture loop after header_parsed is seen set */
+    GstAmlV4l2CodecHeaderInfo header_info;
+    gboolean header_parsed;
+    GstCaps *predicted_caps;
+
+    /* pending frames, min-heap ordered by timestamp */
+    GPtrArray *frame_heap;
+
+    /* decoded pts reporting */
+    GstAmlV4l2PtsRing *pts_ring;
+    guint decoded_pts_interval;
+    guint decoded_pts_count;
+
+    /* capture loop driven by the shared reactor instead of a srcpad task */
+    gboolean shared_reactor;
+    GstAmlV4l2Reactor *reactor;
+    GstAmlV4l2ReactorSource *reactor_src;
+    GstTaskState reactor_state;
+    GMutex reactor_lock;
+    GCond reactor_cond;
+
+    /* scheduling of the decoding thread, applied when it starts */
+    GstAmlV4l2SchedParams sched;
+    GstAmlV4l2SchedSaved *sched_saved;
+
+    /* warm standby context for the next stream, swapped in by set_format */
+    GMutex standby_lock;
+    GstCaps *standby_caps;
+    GstAmlV4l2Object *standby_output;
+    GstAmlV4l2Object *standby_capture;
+    GstCaps *standby_srccaps;
+    GThread *standby_thread;
+    gboolean standby_ready; /* prepared, can be swapped in */
+
+    /* wraps capture dmabufs for the preview and repeated pictures */
+    GstAllocator *dmabuf_allocator;
+
+    /* "preview" request pad carrying the linear double-write picture */
+    GstPad *preview_pad;
+    gboolean preview_started; /* stream-start sent on preview_pad */
+    gboolean preview_caps_pending;
+    gboolean preview_disabled; /* no separate linear picture in this dw mode */
+    GstVideoInfo preview_info;
+    GstVideoInfo preview_main_info; /* capture info preview_info comes from */
+    GstSegment preview_segment;
+    /* pushed from the preview pad task, see preview_queue() */
+    GMutex preview_lock;
+    GCond preview_cond;
+    GQueue preview_queue;
+    gboolean preview_flushing; /* preview pad inactive */
+
+    /* thumbnail mode: one keyframe every interval seconds or keyframes */
+    guint thumbnail_interval;
+    gboolean thumbnail_keyframes;
+    guint thumbnail_count;
+    GstClockTime thumbnail_last;
+
+    /* decode-only: capture buffers are requeued right after DQBUF, only
+     * counted, timed and optionally checksummed */
+    gboolean decode_only;
+    gboolean decode_checksum;
+    guint64 decoded_frames;
+    guint64 decoded_corrupted;
+    GstClockTime decode_start;
+    GstClockTime decode_last;
+    GChecksum *decoded_checksum;
+
+    /* corrupted frames */
+    GstAmlV4l2ErrorPolicy error_policy;
+    guint resync_threshold; /* errors in a row before waiting for a keyframe */
+    guint error_burst;
+    gboolean resync_pending;
+    GstBuffer *last_good;
+    guint64 errors_truncated;
+    guint64 errors_decode;
+    guint64 errors_concealed;
+    guint64 errors_repeated;
+    guint64 errors_dropped;
+    guint64 resyncs;
+    guint64 resync_discarded;
+
 #if GST_IMPORT_LGE_PROP
     /* LGE context */
     GstAmlV4l2VideoDecLgeCtxt *lge_ctxt;